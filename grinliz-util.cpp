@@ -1,11 +1,21 @@
 #include "grinliz/glconsumerproducerqueue.h"
 #include "grinliz/glcontainer.h"
+#include "grinliz/glconcurrenthashtable.h"
+#include "grinliz/glhashimage.h"
 #include "grinliz/glgeometry.h"
 #include "grinliz/glstringutil.h"
 #include "grinliz/glstringpool.h"
 #include "grinliz/gltree.h"
 #include "grinliz/glparser.h"
 #include "grinliz/glrandom.h"
+#include "grinliz/glsort.h"
+#include "grinliz/glparallelsort.h"
+#include "grinliz/glpathfinder.h"
+#include "grinliz/glflowfield.h"
+#include "grinliz/glbitset.h"
+#include "grinliz/glpool.h"
+#include "grinliz/glmemory.h"
+#include "grinliz/glsoa.h"
 
 int CountBits(uint32_t a)
 {
@@ -29,10 +39,21 @@ bool TestRandom()
 	return true;
 }
 
-int main()
+int main(int argc, const char* argv[])
 {
 	TestRandom();
+	grinliz::TestSort();
+	grinliz::TestParallelSort();
 	grinliz::TestContainers();
+	grinliz::TestBitSet();
+	grinliz::TestPool();
+	grinliz::TestArena();
+	grinliz::TestAllocator();
+	grinliz::TestSoA();
+	grinliz::TestConcurrentHashTable();
+	grinliz::TestHashImage();
+	grinliz::TestPathfinder();
+	grinliz::TestFlowField();
 	grinliz::ConsumerProducerQueueTest(clock());
 	grinliz::TestRect();
 	grinliz::TestIntersect();
@@ -42,6 +63,26 @@ int main()
 	grinliz::TestCSV();
 
 	printf("Tests pass.\n");
+
+	// Benchmarks are slow and memory hungry; run on request.
+	if (argc > 1 && strcmp(argv[1], "-bench") == 0) {
+		grinliz::BenchSort();
+		grinliz::BenchParallelSort();
+		grinliz::BenchSearch();
+		grinliz::BenchPQueue();
+		grinliz::BenchPacketQueue();
+		grinliz::BenchSlotMap();
+		grinliz::BenchPool();
+		grinliz::BenchArena();
+		grinliz::BenchSoA();
+		grinliz::BenchPathfinder();
+		grinliz::BenchFlowField();
+		grinliz::BenchBitSet();
+		grinliz::BenchSparseBitSet();
+		grinliz::BenchHashTable();
+		grinliz::BenchConcurrentHashTable();
+		grinliz::BenchHashImage();
+	}
 	return 0;
 }
 
@@ -0,0 +1,747 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glbitset.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#ifdef GRINLIZ_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace grinliz;
+
+namespace {
+	// Each op works on a word, and with AVX2 on 4 words.
+	struct OpAnd {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a & b; }
+#ifdef GRINLIZ_AVX2
+		__m256i operator()(__m256i a, __m256i b) const { return _mm256_and_si256(a, b); }
+#endif
+	};
+	struct OpOr {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a | b; }
+#ifdef GRINLIZ_AVX2
+		__m256i operator()(__m256i a, __m256i b) const { return _mm256_or_si256(a, b); }
+#endif
+	};
+	struct OpXor {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a ^ b; }
+#ifdef GRINLIZ_AVX2
+		__m256i operator()(__m256i a, __m256i b) const { return _mm256_xor_si256(a, b); }
+#endif
+	};
+	struct OpAndNot {
+		uint64_t operator()(uint64_t a, uint64_t b) const { return a & ~b; }
+#ifdef GRINLIZ_AVX2
+		__m256i operator()(__m256i a, __m256i b) const { return _mm256_andnot_si256(b, a); }
+#endif
+	};
+
+	template<class Op>
+	void Combine(uint64_t* dst, const uint64_t* src, int n, Op op) {
+		int i = 0;
+#ifdef GRINLIZ_AVX2
+		for (; i + 4 <= n; i += 4) {
+			__m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+			_mm256_storeu_si256((__m256i*)(dst + i), op(a, b));
+		}
+#endif
+		for (; i < n; ++i)
+			dst[i] = op(dst[i], src[i]);
+	}
+}
+
+void bitwords::And(uint64_t* dst, const uint64_t* src, int n) { Combine(dst, src, n, OpAnd()); }
+void bitwords::Or(uint64_t* dst, const uint64_t* src, int n) { Combine(dst, src, n, OpOr()); }
+void bitwords::Xor(uint64_t* dst, const uint64_t* src, int n) { Combine(dst, src, n, OpXor()); }
+void bitwords::AndNot(uint64_t* dst, const uint64_t* src, int n) { Combine(dst, src, n, OpAndNot()); }
+
+int bitwords::PopCount(const uint64_t* words, int n)
+{
+#ifdef GRINLIZ_AVX2
+	// AVX2 has no popcount; look up each nibble with a shuffle, and
+	// sum the bytes with SAD. (Mula, Kurz & Lemire.)
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i acc = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+		__m256i lo = _mm256_and_si256(v, low);
+		__m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+		__m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(count, _mm256_setzero_si256()));
+	}
+	int count = int(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+		+ _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+#else
+	int count = 0;
+	int i = 0;
+#endif
+	for (; i < n; ++i)
+		count += PopCount64(words[i]);
+	return count;
+}
+
+bool bitwords::Any(const uint64_t* words, int n)
+{
+	int i = 0;
+#ifdef GRINLIZ_AVX2
+	for (; i + 4 <= n; i += 4) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+		if (!_mm256_testz_si256(v, v))
+			return true;
+	}
+#endif
+	uint64_t any = 0;
+	for (; i < n; ++i)
+		any |= words[i];
+	return any != 0;
+}
+
+// Masks for the bits [start, end) of the words they fall in.
+static inline uint64_t FirstMask(int start) { return ~0ULL << (start & 63); }
+static inline uint64_t LastMask(int end) { return ~0ULL >> (63 - ((end - 1) & 63)); }
+
+void bitwords::SetRange(uint64_t* words, int start, int end)
+{
+	if (start >= end) return;
+	int w0 = start >> 6;
+	int w1 = (end - 1) >> 6;
+	if (w0 == w1) {
+		words[w0] |= FirstMask(start) & LastMask(end);
+		return;
+	}
+	words[w0] |= FirstMask(start);
+	for (int w = w0 + 1; w < w1; ++w)
+		words[w] = ~0ULL;
+	words[w1] |= LastMask(end);
+}
+
+void bitwords::ClearRange(uint64_t* words, int start, int end)
+{
+	if (start >= end) return;
+	int w0 = start >> 6;
+	int w1 = (end - 1) >> 6;
+	if (w0 == w1) {
+		words[w0] &= ~(FirstMask(start) & LastMask(end));
+		return;
+	}
+	words[w0] &= ~FirstMask(start);
+	for (int w = w0 + 1; w < w1; ++w)
+		words[w] = 0;
+	words[w1] &= ~LastMask(end);
+}
+
+void BitGrid::FillRect(int x, int y, int w, int h)
+{
+	int x0 = Max(x, 0), x1 = Min(x + w, width);
+	int y0 = Max(y, 0), y1 = Min(y + h, height);
+	for (int row = y0; row < y1; ++row)
+		bitwords::SetRange(Row(row), x0, x1);
+}
+
+void BitGrid::ClearRect(int x, int y, int w, int h)
+{
+	int x0 = Max(x, 0), x1 = Min(x + w, width);
+	int y0 = Max(y, 0), y1 = Min(y + h, height);
+	for (int row = y0; row < y1; ++row)
+		bitwords::ClearRange(Row(row), x0, x1);
+}
+
+int SparseBitSet::AddBlock(uint32_t id)
+{
+	const uint32_t key = id >> PAGE_SHIFT;
+	const int rank = PageRank(key);
+	if (!HasPage(key)) {
+		pages.PushArr(1);
+		Page* mem = pages.Mem();
+		memmove((void*)(mem + rank + 1), (const void*)(mem + rank), (pages.Size() - 1 - rank) * sizeof(Page));
+		mem[rank].key = key;
+		mem[rank].summary = 0;
+		top[key >> 6] |= 1ULL << (key & 63);
+		for (int w = (key >> 6) + 1; w < TOP_WORDS; ++w)
+			++topRank[w];
+	}
+	Page& page = pages[rank];
+	const int pb = (id >> BLOCK_SHIFT) & 63;
+	if (!((page.summary >> pb) & 1)) {
+		// Blocks are only freed once they are empty, so are still 0.
+		int b = freeBlocks.Size() ? freeBlocks.Pop() : int(blocks.PushArr(1) - blocks.Mem());
+		GLASSERT(blocks[b].summary == 0);
+		page.blocks[pb] = b;
+		page.summary |= 1ULL << pb;
+	}
+	return page.blocks[pb];
+}
+
+void SparseBitSet::FreeBlock(Page* page, int pb)
+{
+	GLASSERT(blocks[page->blocks[pb]].summary == 0);
+	freeBlocks.Push(page->blocks[pb]);
+	page->summary &= ~(1ULL << pb);
+}
+
+void SparseBitSet::CompactPages()
+{
+	int n = 0;
+	for (int i = 0; i < pages.Size(); ++i) {
+		const uint32_t key = pages[i].key;
+		if (pages[i].summary)
+			pages[n++] = pages[i];
+		else
+			top[key >> 6] &= ~(1ULL << (key & 63));
+	}
+	while (pages.Size() > n)
+		pages.Pop();
+
+	int rank = 0;
+	for (int w = 0; w < TOP_WORDS; ++w) {
+		topRank[w] = uint16_t(rank);
+		rank += PopCount64(top[w]);
+	}
+}
+
+bool SparseBitSet::Set(uint32_t id)
+{
+	int b = FindBlock(id);
+	if (b < 0)
+		b = AddBlock(id);
+
+	Block& block = blocks[b];
+	const int w = (id >> 6) & 63;
+	const uint64_t bit = 1ULL << (id & 63);
+	if (block.words[w] & bit)
+		return false;
+	block.words[w] |= bit;
+	block.summary |= 1ULL << w;
+	++count;
+	return true;
+}
+
+bool SparseBitSet::Clear(uint32_t id)
+{
+	const uint32_t key = id >> PAGE_SHIFT;
+	if (!HasPage(key))
+		return false;
+	Page& page = pages[PageRank(key)];
+	const int pb = (id >> BLOCK_SHIFT) & 63;
+	if (!((page.summary >> pb) & 1))
+		return false;
+
+	Block& block = blocks[page.blocks[pb]];
+	const int w = (id >> 6) & 63;
+	const uint64_t bit = 1ULL << (id & 63);
+	if (!(block.words[w] & bit))
+		return false;
+	--count;
+	block.words[w] &= ~bit;
+	if (block.words[w] == 0) {
+		block.summary &= ~(1ULL << w);
+		if (block.summary == 0) {
+			FreeBlock(&page, pb);
+			if (page.summary == 0)
+				CompactPages();
+		}
+	}
+	return true;
+}
+
+void SparseBitSet::ClearAll()
+{
+	ClearTop();
+	pages.Clear();
+	blocks.Clear();
+	freeBlocks.Clear();
+	count = 0;
+}
+
+void SparseBitSet::FreeMem()
+{
+	ClearAll();
+	pages.FreeMem();
+	blocks.FreeMem();
+	freeBlocks.FreeMem();
+}
+
+bool SparseBitSet::FindNext(uint32_t start, uint32_t* id) const
+{
+	const uint32_t startKey = start >> PAGE_SHIFT;
+	const int startBlock = (start >> BLOCK_SHIFT) & 63;
+	const int startWord = (start >> 6) & 63;
+
+	for (int i = PageRank(startKey); i < pages.Size(); ++i) {
+		const Page& page = pages[i];
+		const bool firstPage = page.key == startKey;
+		uint64_t ps = page.summary;
+		if (firstPage)
+			ps &= ~0ULL << startBlock;
+		for (; ps; ps &= ps - 1) {
+			const int pb = CountTrailingZeros64(ps);
+			const Block& b = blocks[page.blocks[pb]];
+			// Only the bits at or after 'start' in the first block.
+			const bool firstBlock = firstPage && pb == startBlock;
+			uint64_t s = b.summary;
+			if (firstBlock)
+				s &= ~0ULL << startWord;
+			for (; s; s &= s - 1) {
+				const int w = CountTrailingZeros64(s);
+				uint64_t bits = b.words[w];
+				if (firstBlock && w == startWord)
+					bits &= ~0ULL << (start & 63);
+				if (bits) {
+					*id = (page.key << PAGE_SHIFT) + (uint32_t(pb) << BLOCK_SHIFT) + uint32_t(w << 6) + uint32_t(CountTrailingZeros64(bits));
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+SparseBitSet& SparseBitSet::operator|=(const SparseBitSet& rhs)
+{
+	if (this == &rhs) return *this;
+	for (const Page& rp : rhs.pages) {
+		for (uint64_t ps = rp.summary; ps; ps &= ps - 1) {
+			const int pb = CountTrailingZeros64(ps);
+			const uint32_t base = (rp.key << PAGE_SHIFT) + (uint32_t(pb) << BLOCK_SHIFT);
+			int b = FindBlock(base);
+			if (b < 0)
+				b = AddBlock(base);
+
+			const Block& src = rhs.blocks[rp.blocks[pb]];
+			Block& dst = blocks[b];
+			for (uint64_t s = src.summary; s; s &= s - 1) {
+				const int w = CountTrailingZeros64(s);
+				count += PopCount64(src.words[w] & ~dst.words[w]);
+				dst.words[w] |= src.words[w];
+			}
+			dst.summary |= src.summary;
+		}
+	}
+	return *this;
+}
+
+SparseBitSet& SparseBitSet::operator&=(const SparseBitSet& rhs)
+{
+	if (this == &rhs) return *this;
+	for (Page& page : pages) {
+		for (uint64_t ps = page.summary; ps; ps &= ps - 1) {
+			const int pb = CountTrailingZeros64(ps);
+			Block& dst = blocks[page.blocks[pb]];
+			const int rb = rhs.FindBlock((page.key << PAGE_SHIFT) + (uint32_t(pb) << BLOCK_SHIFT));
+			const Block* src = rb >= 0 ? &rhs.blocks[rb] : 0;
+			for (uint64_t s = dst.summary; s; s &= s - 1) {
+				const int w = CountTrailingZeros64(s);
+				const uint64_t v = src ? dst.words[w] & src->words[w] : 0;
+				count -= PopCount64(dst.words[w] & ~v);
+				dst.words[w] = v;
+				if (!v) dst.summary &= ~(1ULL << w);
+			}
+			if (!dst.summary)
+				FreeBlock(&page, pb);
+		}
+	}
+	CompactPages();
+	return *this;
+}
+
+SparseBitSet& SparseBitSet::AndNot(const SparseBitSet& rhs)
+{
+	if (this == &rhs) {
+		ClearAll();
+		return *this;
+	}
+	for (Page& page : pages) {
+		for (uint64_t ps = page.summary; ps; ps &= ps - 1) {
+			const int pb = CountTrailingZeros64(ps);
+			const int rb = rhs.FindBlock((page.key << PAGE_SHIFT) + (uint32_t(pb) << BLOCK_SHIFT));
+			if (rb < 0) continue;
+
+			Block& dst = blocks[page.blocks[pb]];
+			const Block& src = rhs.blocks[rb];
+			for (uint64_t s = dst.summary & src.summary; s; s &= s - 1) {
+				const int w = CountTrailingZeros64(s);
+				count -= PopCount64(dst.words[w] & src.words[w]);
+				dst.words[w] &= ~src.words[w];
+				if (!dst.words[w]) dst.summary &= ~(1ULL << w);
+			}
+			if (!dst.summary)
+				FreeBlock(&page, pb);
+		}
+	}
+	CompactPages();
+	return *this;
+}
+
+bool SparseBitSet::operator==(const SparseBitSet& rhs) const
+{
+	if (count != rhs.count || pages.Size() != rhs.pages.Size())
+		return false;
+	for (int i = 0; i < pages.Size(); ++i) {
+		const Page& a = pages[i];
+		const Page& b = rhs.pages[i];
+		if (a.key != b.key || a.summary != b.summary)
+			return false;
+		for (uint64_t ps = a.summary; ps; ps &= ps - 1) {
+			const int pb = CountTrailingZeros64(ps);
+			// Unused words are always 0, so the whole block can be compared.
+			if (memcmp(&blocks[a.blocks[pb]], &rhs.blocks[b.blocks[pb]], sizeof(Block)) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+void grinliz::TestBitSet()
+{
+	Random random(61);
+	// BitSet against an array of bools, at sizes around the word edges.
+	static const int SIZES[] = { 0, 1, 63, 64, 65, 255, 256, 257, 1000 };
+	for (int n : SIZES) {
+		BitSet a(n), b(n);
+		bool* ra = new bool[n + 1];
+		bool* rb = new bool[n + 1];
+		for (int i = 0; i < n; ++i) {
+			ra[i] = random.Rand(3) == 0;
+			rb[i] = random.Rand(2) == 0;
+			a.Set(i, ra[i]);
+			b.Set(i, rb[i]);
+		}
+		if (n) {
+			int s = random.Rand(n), e = s + random.Rand(n - s + 1);
+			a.SetRange(s, e);
+			for (int i = s; i < e; ++i) ra[i] = true;
+			s = random.Rand(n); e = s + random.Rand(n - s + 1);
+			b.ClearRange(s, e);
+			for (int i = s; i < e; ++i) rb[i] = false;
+		}
+
+		for (int op = 0; op < 4; ++op) {
+			BitSet c = a;
+			switch (op) {
+			case 0: c &= b; break;
+			case 1: c |= b; break;
+			case 2: c ^= b; break;
+			case 3: c.AndNot(b); break;
+			}
+			int count = 0;
+			for (int i = 0; i < n; ++i) {
+				bool r = op == 0 ? (ra[i] && rb[i]) : op == 1 ? (ra[i] || rb[i]) : op == 2 ? (ra[i] != rb[i]) : (ra[i] && !rb[i]);
+				GLASSERT(c.IsSet(i) == r);
+				if (r) ++count;
+			}
+			GLASSERT(c.PopCount() == count);
+			GLASSERT(c.Any() == (count > 0));
+		}
+
+		// Iterating the set bits, and the clear ones.
+		int next = 0, nextClear = 0;
+		for (int i = 0; i < n; ++i) {
+			if (ra[i]) {
+				GLASSERT(a.FindNext(next) == i);
+				next = i + 1;
+			}
+			else {
+				GLASSERT(a.FindNextClear(nextClear) == i);
+				nextClear = i + 1;
+			}
+		}
+		GLASSERT(a.FindNext(next) == -1 && a.FindNextClear(nextClear) == -1);
+		(void)next;
+		(void)nextClear;
+
+		a.SetAll();
+		GLASSERT(a.PopCount() == n);
+		a.ClearAll();
+		GLASSERT(!a.Any() && a == BitSet(n));
+		delete[] ra;
+		delete[] rb;
+	}
+	// BitGrid
+	{
+		BitGrid grid(300, 20);
+		GLASSERT(grid.Stride() == 8);
+		grid.FillRect(-5, 2, 100, 3);
+		grid.FillRect(250, 3, 100, 10);		// clipped
+		grid.ClearRect(10, 3, 20, 1);
+		GLASSERT(grid.PopCount() == 95 * 3 - 20 + 50 * 10);
+		GLASSERT(grid.PopCountRow(3) == 95 - 20 + 50);
+		GLASSERT(grid.IsSet(0, 2) && grid.IsSet(94, 2) && !grid.IsSet(95, 2));
+		GLASSERT(grid.IsSet(299, 12) && !grid.IsSet(249, 12));
+
+		// Runs in row 3: [0, 10) [30, 95) [250, 300)
+		int runs[3][2] = { { 0, 10 }, { 30, 95 }, { 250, 300 } };
+		int x = 0;
+		for (int r = 0; r < 3; ++r) {
+			int start = grid.FindNextInRow(3, x);
+			int end = grid.FindNextClearInRow(3, start);
+			if (end < 0) end = grid.Width();
+			GLASSERT(start == runs[r][0] && end == runs[r][1]);
+			x = end;
+		}
+		GLASSERT(grid.FindNextInRow(3, x) == -1);
+		(void)runs;
+
+		BitGrid mask(300, 20);
+		mask.FillRect(0, 0, 300, 3);
+		BitGrid g2 = grid;
+		g2 &= mask;
+		GLASSERT(g2.PopCount() == 95);
+		grid.AndNot(mask);
+		GLASSERT(grid.PopCount() == 95 * 2 - 20 + 50 * 10);
+		grid |= mask;
+		grid ^= mask;
+		GLASSERT(grid.PopCount() == 95 * 2 - 20 + 50 * 10);
+	}
+	// SparseBitSet against sorted arrays of ids, clustered across the
+	// whole 32 bit range.
+	{
+		static const int N = 3000;
+		auto RandomIds = [&random](SparseBitSet* set, CDynArray<uint32_t>* ref) {
+			for (int i = 0; i < N; ++i) {
+				uint32_t base = uint32_t(random.Rand(16)) << 28;
+				uint32_t id = base + uint32_t(random.Rand(20000));
+				if (random.Rand(50) == 0) id = 0xffffffff - uint32_t(random.Rand(64));
+				set->Set(id);
+				ref->Push(id);
+			}
+			ref->Sort();
+			int n = 0;
+			for (int i = 0; i < ref->Size(); ++i) {
+				if (i == 0 || (*ref)[i] != (*ref)[i - 1])
+					(*ref)[n++] = (*ref)[i];
+			}
+			ref->Truncate(n);
+		};
+		auto Check = [](const SparseBitSet& set, const CDynArray<uint32_t>& ref) {
+			GLASSERT(set.PopCount() == ref.Size());
+			int i = 0;
+			set.ForEach([&](uint32_t id) {
+				GLASSERT(i < ref.Size() && ref[i] == id);
+				(void)id;
+				++i;
+			});
+			GLASSERT(i == ref.Size());
+			uint32_t id = 0;
+			bool found = set.FindNext(0, &id);
+			for (int k = 0; k < ref.Size(); ++k) {
+				GLASSERT(found && id == ref[k] && set.IsSet(id));
+				found = id < 0xffffffff && set.FindNext(id + 1, &id);
+			}
+			GLASSERT(!found);
+			(void)found;
+		};
+
+		SparseBitSet a, b;
+		CDynArray<uint32_t> ra, rb;
+		RandomIds(&a, &ra);
+		RandomIds(&b, &rb);
+		Check(a, ra);
+		Check(b, rb);
+		GLASSERT(!a.Set(ra[0]) && a.PopCount() == ra.Size());
+		GLASSERT(!a.IsSet(ra[0] + 1) || ra[1] == ra[0] + 1);
+
+		// Clear half; emptied blocks are freed and reused.
+		SparseBitSet c = a;
+		CDynArray<uint32_t> rc;
+		for (int i = 0; i < ra.Size(); ++i) {
+			if (i & 1) {
+				bool cleared = c.Clear(ra[i]);
+				GLASSERT(cleared);
+				(void)cleared;
+			}
+			else {
+				rc.Push(ra[i]);
+			}
+		}
+		bool cleared = c.Clear(ra[1]);
+		GLASSERT(!cleared);
+		(void)cleared;
+		Check(c, rc);
+		GLASSERT(c.NumBlocks() <= a.NumBlocks());
+
+		for (int op = 0; op < 3; ++op) {
+			SparseBitSet d = a;
+			CDynArray<uint32_t> rd;
+			int i = 0, j = 0;
+			while (i < ra.Size() || j < rb.Size()) {
+				bool inA = i < ra.Size() && (j == rb.Size() || ra[i] <= rb[j]);
+				bool inB = j < rb.Size() && (i == ra.Size() || rb[j] <= ra[i]);
+				uint32_t id = inA ? ra[i] : rb[j];
+				if ((op == 0 && (inA || inB)) || (op == 1 && inA && inB) || (op == 2 && inA && !inB))
+					rd.Push(id);
+				if (inA) ++i;
+				if (inB) ++j;
+			}
+			switch (op) {
+			case 0: d |= b; break;
+			case 1: d &= b; break;
+			case 2: d.AndNot(b); break;
+			}
+			Check(d, rd);
+		}
+
+		SparseBitSet e = a;
+		GLASSERT(e == a);
+		e |= b;
+		e.AndNot(b);
+		a.AndNot(b);
+		GLASSERT(e == a);
+		e.ClearAll();
+		GLASSERT(e.Empty() && e.NumBlocks() == 0 && !e.IsSet(ra[0]));
+	}
+}
+
+void grinliz::BenchBitSet()
+{
+	static const int SIZE = 4096;
+	static const int REPEAT = 10;
+	Random random(3);
+	BitGrid a(SIZE, SIZE), b(SIZE, SIZE);
+	int check = 0;
+
+	// Rectangles, bit by bit vs. a row of words at a time.
+	timePoint_t start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int y = 0; y < SIZE / 2; ++y)
+			for (int x = 0; x < SIZE / 2; ++x)
+				a.Set(r + x, r + y);
+	}
+	double tRectBits = DeltaSeconds(start, Now());
+	start = Now();
+	for (int r = 0; r < REPEAT; ++r)
+		b.FillRect(r, r, SIZE / 2, SIZE / 2);
+	double tRect = DeltaSeconds(start, Now());
+
+	for (int y = 0; y < SIZE; ++y)
+		for (int x = 0; x < SIZE; x += 1 + random.Rand(8))
+			b.Set(x, y);
+
+	// Combine and count, bit by bit vs. bulk.
+	start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int y = 0; y < SIZE; ++y) {
+			for (int x = 0; x < SIZE; ++x) {
+				a.Set(x, y, a.IsSet(x, y) && b.IsSet(x, y));
+				check += a.IsSet(x, y);
+			}
+		}
+	}
+	double tAndBits = DeltaSeconds(start, Now());
+	start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		a &= b;
+		check += a.PopCount();
+	}
+	double tAnd = DeltaSeconds(start, Now());
+
+	const double ms = 1000.0 / REPEAT;
+	printf("BitGrid %dx%d (ms): rect bits=%.2f FillRect=%.3f  and+count bits=%.2f bulk=%.3f %s(check=%d)\n",
+		SIZE, SIZE, tRectBits * ms, tRect * ms, tAndBits * ms, tAnd * ms,
+#ifdef GRINLIZ_AVX2
+		"AVX2 ",
+#else
+		"",
+#endif
+		check);
+}
+
+void grinliz::BenchSparseBitSet()
+{
+	// Dirty entity tracking: mark, test, walk and clear, each frame.
+	static const int N = 100000;
+	static const int FRAMES = 20;
+	Random random(7);
+	CDynArray<uint32_t> ids;
+	for (int i = 0; i < N; ++i)
+		ids.Push(uint32_t(random.Rand(1 << 20)) | (uint32_t(random.Rand(4)) << 30));
+
+	int64_t check = 0;
+	timePoint_t start = Now();
+	IntHashTable<uint32_t, bool> hash;
+	for (int f = 0; f < FRAMES; ++f) {
+		for (uint32_t id : ids)
+			hash.Add(id, true);
+		for (int i = 0; i < N; ++i) {
+			bool v = false;
+			check += hash.TryGet(ids[i] ^ 1, &v) ? 1 : 0;
+		}
+		for (auto it = hash.GetIterator(); !it.Done(); it.Next())
+			check += it.Key() & 1;
+		hash.Clear();
+	}
+	double tHash = DeltaSeconds(start, Now());
+
+	start = Now();
+	SparseBitSet set;
+	for (int f = 0; f < FRAMES; ++f) {
+		for (uint32_t id : ids)
+			set.Set(id);
+		for (int i = 0; i < N; ++i)
+			check += set.IsSet(ids[i] ^ 1) ? 1 : 0;
+		set.ForEach([&check](uint32_t id) { check += id & 1; });
+		set.ClearAll();
+	}
+	double tSet = DeltaSeconds(start, Now());
+
+	// Intersect with a second set: lookups vs. a block at a time.
+	IntHashTable<uint32_t, bool> hash2;
+	SparseBitSet set2;
+	for (uint32_t id : ids) {
+		hash.Add(id, true);
+		set.Set(id);
+		uint32_t id2 = id ^ uint32_t(random.Rand(64));
+		hash2.Add(id2, true);
+		set2.Set(id2);
+	}
+	start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		IntHashTable<uint32_t, bool> both;
+		for (auto it = hash.GetIterator(); !it.Done(); it.Next()) {
+			bool v = false;
+			if (hash2.TryGet(it.Key(), &v))
+				both.Add(it.Key(), true);
+		}
+		check += both.Size();
+	}
+	double tHashAnd = DeltaSeconds(start, Now());
+	start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		SparseBitSet both = set;
+		both &= set2;
+		check += both.PopCount();
+	}
+	double tSetAnd = DeltaSeconds(start, Now());
+
+	printf("Dirty set of %d ids (ms/frame): IntHashTable=%.2f SparseBitSet=%.2f  intersect: %.2f vs %.2f  memory: %dk vs %dk (check=%d)\n",
+		N, tHash * 1000.0 / FRAMES, tSet * 1000.0 / FRAMES, tHashAnd * 1000.0 / FRAMES, tSetAnd * 1000.0 / FRAMES,
+		int(hash.MemoryInUse() / 1024), int(set.MemoryInUse() / 1024), int(check));
+}
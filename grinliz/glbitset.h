@@ -0,0 +1,321 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_BITSET_INCLUDED
+#define GRINLIZ_BITSET_INCLUDED
+
+#include <stdint.h>
+#include "glcontainer.h"
+
+#if defined(__AVX2__)
+#define GRINLIZ_AVX2
+#endif
+
+namespace grinliz
+{
+
+void TestBitSet();
+void BenchBitSet();
+void BenchSparseBitSet();
+
+/*	Operations on arrays of 64 bit words, shared by BitSet and BitGrid.
+	The bulk operations use AVX2 when it is enabled at compile time
+	(/arch:AVX2, -mavx2.)
+*/
+namespace bitwords
+{
+	void And(uint64_t* dst, const uint64_t* src, int n);
+	void Or(uint64_t* dst, const uint64_t* src, int n);
+	void Xor(uint64_t* dst, const uint64_t* src, int n);
+	void AndNot(uint64_t* dst, const uint64_t* src, int n);	// dst & ~src
+	int PopCount(const uint64_t* words, int n);
+	bool Any(const uint64_t* words, int n);
+
+	// Sets or clears the bits [start, end).
+	void SetRange(uint64_t* words, int start, int end);
+	void ClearRange(uint64_t* words, int start, int end);
+
+	// The first bit set (or clear, if INVERT) in [start, end), or -1.
+	template<bool INVERT>
+	int FindNext(const uint64_t* words, int start, int end) {
+		if (start >= end) return -1;
+		int w = start >> 6;
+		uint64_t bits = (INVERT ? ~words[w] : words[w]) & (~0ULL << (start & 63));
+		const int last = (end - 1) >> 6;
+		while (!bits) {
+			if (++w > last) return -1;
+			bits = INVERT ? ~words[w] : words[w];
+		}
+		int i = (w << 6) + CountTrailingZeros64(bits);
+		return i < end ? i : -1;
+	}
+}
+
+/*	A runtime sized set of bits, stored in 64 bit words. Bits past
+	Size() are always 0. The bulk operations (&=, |=, ^=, AndNot, 
+	PopCount) work a word - or with AVX2, 4 words - at a time.
+*/
+class BitSet
+{
+public:
+	BitSet() {}
+	explicit BitSet(int nBits) { Resize(nBits); }
+
+	// Resizes and clears all the bits.
+	void Resize(int nBits) {
+		GLASSERT(nBits >= 0);
+		size = nBits;
+		nWords = ((nBits + 255) >> 8) * 4;
+		words.Clear();
+		memset(words.PushArr(nWords), 0, nWords * sizeof(uint64_t));
+	}
+
+	int Size() const { return size; }
+
+	bool IsSet(int i) const { GLASSERT(i >= 0 && i < size); return (words[i >> 6] >> (i & 63)) & 1; }
+	void Set(int i) { GLASSERT(i >= 0 && i < size); words[i >> 6] |= 1ULL << (i & 63); }
+	void Clear(int i) { GLASSERT(i >= 0 && i < size); words[i >> 6] &= ~(1ULL << (i & 63)); }
+	void Set(int i, bool v) { if (v) Set(i); else Clear(i); }
+	void Flip(int i) { GLASSERT(i >= 0 && i < size); words[i >> 6] ^= 1ULL << (i & 63); }
+
+	void SetAll() { SetRange(0, size); }
+	void ClearAll() { memset(words.Mem(), 0, nWords * sizeof(uint64_t)); }
+	// Sets or clears the bits [start, end).
+	void SetRange(int start, int end) { CheckRange(start, end); bitwords::SetRange(words.Mem(), start, end); }
+	void ClearRange(int start, int end) { CheckRange(start, end); bitwords::ClearRange(words.Mem(), start, end); }
+
+	// The sets must be the same size.
+	BitSet& operator&=(const BitSet& rhs) { GLASSERT(size == rhs.size); bitwords::And(words.Mem(), rhs.words.Mem(), nWords); return *this; }
+	BitSet& operator|=(const BitSet& rhs) { GLASSERT(size == rhs.size); bitwords::Or(words.Mem(), rhs.words.Mem(), nWords); return *this; }
+	BitSet& operator^=(const BitSet& rhs) { GLASSERT(size == rhs.size); bitwords::Xor(words.Mem(), rhs.words.Mem(), nWords); return *this; }
+	// Clears the bits that are set in 'rhs'.
+	BitSet& AndNot(const BitSet& rhs) { GLASSERT(size == rhs.size); bitwords::AndNot(words.Mem(), rhs.words.Mem(), nWords); return *this; }
+
+	bool operator==(const BitSet& rhs) const {
+		return size == rhs.size && memcmp(words.Mem(), rhs.words.Mem(), nWords * sizeof(uint64_t)) == 0;
+	}
+	bool operator!=(const BitSet& rhs) const { return !(*this == rhs); }
+
+	int PopCount() const { return bitwords::PopCount(words.Mem(), nWords); }
+	bool Any() const { return bitwords::Any(words.Mem(), nWords); }
+
+	// The first bit set at or after 'i', or -1. Iterate with:
+	// for (int i = set.FindNext(0); i >= 0; i = set.FindNext(i + 1))
+	int FindNext(int i) const { return bitwords::FindNext<false>(words.Mem(), i, size); }
+	int FindNextClear(int i) const { return bitwords::FindNext<true>(words.Mem(), i, size); }
+
+	const uint64_t* Words() const { return words.Mem(); }
+	int NumWords() const { return nWords; }
+
+private:
+	void CheckRange(int start, int end) const { GLASSERT(start >= 0 && start <= end && end <= size); (void)start; (void)end; }
+
+	int size = 0;
+	int nWords = 0;		// a multiple of 4: 256 bits
+	CDynArray<uint64_t> words;
+};
+
+/*	A runtime sized 2D grid of bits, for occupancy and visibility masks.
+	Each row starts on a new word, and is padded to a multiple of 
+	256 bits, so rows can be scanned and combined a word at a time.
+*/
+class BitGrid
+{
+public:
+	BitGrid() {}
+	BitGrid(int width, int height) { Resize(width, height); }
+
+	// Resizes and clears all the bits.
+	void Resize(int w, int h) {
+		GLASSERT(w >= 0 && h >= 0);
+		width = w;
+		height = h;
+		stride = ((w + 255) >> 8) * 4;
+		words.Clear();
+		memset(words.PushArr(stride * h), 0, stride * h * sizeof(uint64_t));
+	}
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	// Words per row.
+	int Stride() const { return stride; }
+
+	bool IsSet(int x, int y) const { return (Word(x, y) >> (x & 63)) & 1; }
+	void Set(int x, int y) { Word(x, y) |= 1ULL << (x & 63); }
+	void Clear(int x, int y) { Word(x, y) &= ~(1ULL << (x & 63)); }
+	void Set(int x, int y, bool v) { if (v) Set(x, y); else Clear(x, y); }
+
+	void ClearAll() { memset(words.Mem(), 0, words.Size() * sizeof(uint64_t)); }
+	// Sets or clears the rectangle (x, y, w, h), clipped to the grid.
+	void FillRect(int x, int y, int w, int h);
+	void ClearRect(int x, int y, int w, int h);
+
+	// The grids must be the same size.
+	BitGrid& operator&=(const BitGrid& rhs) { CheckSize(rhs); bitwords::And(words.Mem(), rhs.words.Mem(), words.Size()); return *this; }
+	BitGrid& operator|=(const BitGrid& rhs) { CheckSize(rhs); bitwords::Or(words.Mem(), rhs.words.Mem(), words.Size()); return *this; }
+	BitGrid& operator^=(const BitGrid& rhs) { CheckSize(rhs); bitwords::Xor(words.Mem(), rhs.words.Mem(), words.Size()); return *this; }
+	BitGrid& AndNot(const BitGrid& rhs) { CheckSize(rhs); bitwords::AndNot(words.Mem(), rhs.words.Mem(), words.Size()); return *this; }
+
+	int PopCount() const { return bitwords::PopCount(words.Mem(), words.Size()); }
+	int PopCountRow(int y) const { return bitwords::PopCount(Row(y), stride); }
+	bool Any() const { return bitwords::Any(words.Mem(), words.Size()); }
+
+	// The first x at or after 'x' in row 'y' that is set (or clear), or -1.
+	// Runs of set bits are [FindNextInRow(y, x), FindNextClearInRow(y, start)).
+	int FindNextInRow(int y, int x) const { return bitwords::FindNext<false>(Row(y), x, width); }
+	int FindNextClearInRow(int y, int x) const { return bitwords::FindNext<true>(Row(y), x, width); }
+
+	const uint64_t* Row(int y) const { GLASSERT(y >= 0 && y < height); return words.Mem() + y * stride; }
+	uint64_t* Row(int y) { GLASSERT(y >= 0 && y < height); return words.Mem() + y * stride; }
+
+private:
+	uint64_t& Word(int x, int y) { GLASSERT(x >= 0 && x < width && y >= 0 && y < height); return words[y * stride + (x >> 6)]; }
+	uint64_t Word(int x, int y) const { GLASSERT(x >= 0 && x < width && y >= 0 && y < height); return words[y * stride + (x >> 6)]; }
+	void CheckSize(const BitGrid& rhs) const { GLASSERT(width == rhs.width && height == rhs.height); (void)rhs; }
+
+	int width = 0;
+	int height = 0;
+	int stride = 0;
+	CDynArray<uint64_t> words;
+};
+
+/*	A set of 32 bit ids, for sparse id spaces. Three levels:
+	- a Block holds 4096 bits in 64 words, and a summary word with
+	  a bit for each word that is not 0.
+	- a Page holds up to 64 blocks (2^18 ids), and a summary word
+	  with a bit for each block it has.
+	- the top summarizes which of the 2^14 pages exist. Pages are 
+	  stored in id order, and found by the rank of their top bit.
+	Only pages and blocks with bits set are allocated, so memory 
+	follows the population (plus a fixed 2.5k for the top level), not
+	the id range. A lookup is a few loads with no search, and 
+	iteration, union and intersection skip empty words and blocks.
+
+	Freed blocks are reused, but their memory is only released by
+	FreeMem().
+*/
+class SparseBitSet
+{
+public:
+	SparseBitSet() { ClearTop(); }
+
+	bool IsSet(uint32_t id) const {
+		int b = FindBlock(id);
+		return b >= 0 && ((blocks[b].words[(id >> 6) & 63] >> (id & 63)) & 1);
+	}
+	// Returns true if the bit was not already set.
+	bool Set(uint32_t id);
+	// Returns true if the bit was set.
+	bool Clear(uint32_t id);
+
+	void ClearAll();
+	void FreeMem();
+
+	int64_t PopCount() const { return count; }
+	bool Empty() const { return count == 0; }
+
+	// The first id set at or after 'start'. Returns false if there is none.
+	bool FindNext(uint32_t start, uint32_t* id) const;
+
+	// Calls func(uint32_t id) for every id set, in increasing order.
+	template<typename Func>
+	void ForEach(Func func) const {
+		for (const Page& page : pages) {
+			for (uint64_t ps = page.summary; ps; ps &= ps - 1) {
+				int pb = CountTrailingZeros64(ps);
+				const Block& b = blocks[page.blocks[pb]];
+				const uint32_t base = (page.key << PAGE_SHIFT) + (uint32_t(pb) << BLOCK_SHIFT);
+				for (uint64_t s = b.summary; s; s &= s - 1) {
+					int w = CountTrailingZeros64(s);
+					for (uint64_t bits = b.words[w]; bits; bits &= bits - 1)
+						func(base + uint32_t(w << 6) + uint32_t(CountTrailingZeros64(bits)));
+				}
+			}
+		}
+	}
+
+	SparseBitSet& operator|=(const SparseBitSet& rhs);
+	SparseBitSet& operator&=(const SparseBitSet& rhs);
+	// Clears the ids that are set in 'rhs'.
+	SparseBitSet& AndNot(const SparseBitSet& rhs);
+
+	bool operator==(const SparseBitSet& rhs) const;
+	bool operator!=(const SparseBitSet& rhs) const { return !(*this == rhs); }
+
+	int NumBlocks() const { return blocks.Size() - freeBlocks.Size(); }
+	size_t MemoryInUse() const {
+		return sizeof(*this) + pages.Capacity() * sizeof(Page) 
+			+ blocks.Capacity() * sizeof(Block) + freeBlocks.Capacity() * sizeof(int);
+	}
+
+private:
+	static const int BLOCK_SHIFT = 12;	// 4096 ids per block
+	static const int PAGE_SHIFT = 18;	// 64 blocks per page
+	static const int TOP_WORDS = 1 << (32 - PAGE_SHIFT - 6);
+
+	struct Block {
+		uint64_t summary;
+		uint64_t words[64];
+	};
+	struct Page {
+		uint32_t key;		// id >> PAGE_SHIFT
+		uint64_t summary;
+		int blocks[64];		// index in 'blocks', if the summary bit is set
+	};
+
+	// Index of the first page with a key >= 'key'.
+	int PageRank(uint32_t key) const {
+		return topRank[key >> 6] + PopCount64(top[key >> 6] & ((1ULL << (key & 63)) - 1));
+	}
+	bool HasPage(uint32_t key) const { return (top[key >> 6] >> (key & 63)) & 1; }
+
+	int FindBlock(uint32_t id) const {
+		const uint32_t key = id >> PAGE_SHIFT;
+		if (!HasPage(key)) return -1;
+		const Page& page = pages[PageRank(key)];
+		const int pb = (id >> BLOCK_SHIFT) & 63;
+		return ((page.summary >> pb) & 1) ? page.blocks[pb] : -1;
+	}
+	// Returns the block for 'id', adding it (and its page) if needed.
+	int AddBlock(uint32_t id);
+	void FreeBlock(Page* page, int pb);
+	// Removes the pages that have no blocks.
+	void CompactPages();
+	void ClearTop() {
+		memset(top, 0, sizeof(top));
+		memset(topRank, 0, sizeof(topRank));
+	}
+
+	uint64_t top[TOP_WORDS];
+	uint16_t topRank[TOP_WORDS];	// pages before top[i]
+	DynArray<Page> pages;		// in key order
+	DynArray<Block> blocks;
+	CDynArray<int> freeBlocks;
+	int64_t count = 0;
+};
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_BITSET_INCLUDED
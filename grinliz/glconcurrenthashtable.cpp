@@ -0,0 +1,161 @@
+#include "glconcurrenthashtable.h"
+#include "glrandom.h"
+#include "glperformance.h"
+#include "../enkiTS/TaskScheduler.h"
+
+using namespace grinliz;
+
+void grinliz::TestConcurrentHashTable()
+{
+	{
+		ConcurrentIntHashTable<uint32_t, uint32_t> table(2);
+		static const int N = 10'000;
+		for (int i = 0; i < N; ++i)
+			table.Add(i, i * 3);
+		GLASSERT(table.Size() == N);
+		for (int i = 0; i < N; i += 2) {
+			uint32_t v = 0;
+			bool removed = table.Remove(i, &v);
+			GLASSERT(removed && v == uint32_t(i * 3));
+			(void)removed;
+		}
+		bool removed = table.Remove(0);
+		GLASSERT(!removed);
+		(void)removed;
+		GLASSERT(table.Size() == N / 2);
+		for (int i = 0; i < N; ++i) {
+			uint32_t v = 0;
+			bool found = table.TryGet(i, &v);
+			GLASSERT(found == ((i & 1) == 1));
+			GLASSERT(!found || v == uint32_t(i * 3));
+			(void)found;
+		}
+		table.Add(1, 7);
+		GLASSERT(table.Size() == N / 2);
+		uint32_t v = 0;
+		GLASSERT(table.TryGet(1, &v) && v == 7);
+		(void)v;
+		table.Collect();
+	}
+	{
+		// Readers check a stable set of keys while writers churn
+		// other keys through the same shards (growing them, and
+		// shifting buckets on removal.)
+		static const int STABLE = 20'000;
+		static const int CHURN = 50'000;
+		static const int TASKS = 8;
+
+		ConcurrentIntHashTable<uint32_t, uint32_t> table(3);
+		for (uint32_t i = 0; i < STABLE; ++i)
+			table.Add(i, i + 1);
+
+		std::atomic<int> errors = { 0 };
+		enki::TaskScheduler ts;
+		ts.Initialize(4);
+		enki::TaskSet task(TASKS, [&](enki::TaskSetPartition range, uint32_t) {
+			for (uint32_t t = range.start; t < range.end; ++t) {
+				Random r(t + 1);
+				if (t & 1) {
+					for (int i = 0; i < 200'000; ++i) {
+						uint32_t k = r.Rand(STABLE);
+						uint32_t v = 0;
+						if (!table.TryGet(k, &v) || v != k + 1)
+							errors++;
+					}
+				}
+				else {
+					// Each writer owns its own range of keys.
+					uint32_t base = STABLE + t * CHURN;
+					for (uint32_t i = 0; i < CHURN; ++i)
+						table.Add(base + i, i);
+					for (uint32_t i = 0; i < CHURN; ++i) {
+						if (!table.Remove(base + i))
+							errors++;
+					}
+				}
+			}
+		});
+		ts.AddTaskSetToPipe(&task);
+		ts.WaitforTask(&task);
+		ts.WaitforAllAndShutdown();
+
+		GLASSERT(errors == 0);
+		GLASSERT(table.Size() == STABLE);
+		table.Collect();
+	}
+}
+
+
+void grinliz::BenchConcurrentHashTable()
+{
+	static const int N_KEYS = 1'000'000;
+	static const int OPS_PER_CHUNK = 100'000;
+	static const int WRITE_PERCENT = 10;
+
+	// What the workers do today: one table, one lock.
+	struct GlobalLockTable {
+		IntHashTable<uint32_t, uint32_t> table;
+		std::mutex mutex;
+
+		void Add(uint32_t k, uint32_t v) {
+			std::lock_guard<std::mutex> lock(mutex);
+			table.Add(k, v);
+		}
+		bool TryGet(uint32_t k, uint32_t* v) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return table.TryGet(k, v);
+		}
+	};
+
+	GlobalLockTable global;
+	ConcurrentIntHashTable<uint32_t, uint32_t> sharded;
+	for (uint32_t i = 0; i < N_KEYS; ++i) {
+		global.Add(i, i);
+		sharded.Add(i, i);
+	}
+
+	const int maxThreads = int(enki::GetNumHardwareThreads());
+	printf("Concurrent hash table, %d keys, %d%% writes\n", N_KEYS, WRITE_PERCENT);
+	for (int n = 1; n < maxThreads * 2; n *= 2) {
+		const int nThreads = Min(n, maxThreads);
+		enki::TaskScheduler ts;
+		ts.Initialize(nThreads);
+		const int nChunks = nThreads * 8;
+		std::atomic<uint64_t> check = { 0 };
+
+		auto run = [&](auto& table) {
+			enki::TaskSet task(nChunks, [&](enki::TaskSetPartition range, uint32_t) {
+				uint64_t c = 0;
+				for (uint32_t chunk = range.start; chunk < range.end; ++chunk) {
+					Random r(chunk + 1);
+					for (int i = 0; i < OPS_PER_CHUNK; ++i) {
+						uint32_t k = r.Rand(N_KEYS);
+						if (r.Rand(100) < WRITE_PERCENT) {
+							table.Add(k, k);
+						}
+						else {
+							uint32_t v = 0;
+							table.TryGet(k, &v);
+							c += v;
+						}
+					}
+				}
+				check += c;
+			});
+			timePoint_t start = Now();
+			ts.AddTaskSetToPipe(&task);
+			ts.WaitforTask(&task);
+			return DeltaSeconds(start, Now());
+		};
+
+		double tGlobal = run(global);
+		double tSharded = run(sharded);
+		double ops = double(nChunks) * OPS_PER_CHUNK;
+		printf("  threads=%2d  global lock=%6.1f Mops/s  sharded=%6.1f Mops/s\n",
+			nThreads, ops / tGlobal / 1.0e6, ops / tSharded / 1.0e6);
+		ts.WaitforAllAndShutdown();
+		if (nThreads == maxThreads)
+			break;
+	}
+	sharded.Collect();
+}
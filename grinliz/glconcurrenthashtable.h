@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+#ifndef GRINLIZ_CONCURRENT_HASHTABLE_INCLUDED
+#define GRINLIZ_CONCURRENT_HASHTABLE_INCLUDED
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "glcontainer.h"
+
+namespace grinliz
+{
+
+void TestConcurrentHashTable();
+void BenchConcurrentHashTable();
+
+/* A hash table that many threads can read and write at once.
+   Blittable data only, like HashTable.
+
+   The keys are split across shards (by the top bits of the hash) and
+   each shard has its own lock, so writers only contend when they hit 
+   the same shard. Readers never lock: each shard has a sequence 
+   count (a seqlock) that a writer makes odd while it changes the 
+   shard. A reader copies out what it found, and tries again if the
+   count changed underneath it.
+
+   Since readers don't lock, a shard can't free its buckets when it 
+   grows - a reader may still be looking at them. The old buckets are
+   retired, and freed by Collect(), which must be called when no 
+   thread is reading. (Between frames, or after the tasks that use the
+   table are done.) Growth is geometric, so the retired memory is less
+   than the live memory. The buckets come from the Allocator policy
+   (see glmemory.h).
+*/
+template <class K, class V, class H = BlitHash<K>, class Allocator = DefaultAlloc>
+class ConcurrentHashTable
+{
+public:
+	// 'shardBits' sets the number of shards: 1 << shardBits. 
+	explicit ConcurrentHashTable(int shardBits = 6) {
+		GLASSERT(shardBits >= 0 && shardBits <= 16);
+		this->shardBits = shardBits;
+		nShards = 1 << shardBits;
+		shards = new Shard[nShards];
+	}
+
+	~ConcurrentHashTable() {
+		for (int i = 0; i < nShards; ++i) {
+			Shard& s = shards[i];
+			s.table.load(std::memory_order_relaxed)->Free();
+			delete s.table.load(std::memory_order_relaxed);
+		}
+		Collect();
+		delete[] shards;
+	}
+
+	// Adds or replaces. Locks one shard.
+	void Add(const K& key, const V& value) {
+		const uint64_t h = Hash(key);
+		Shard& s = GetShard(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		Table* t = s.table.load(std::memory_order_relaxed);
+
+		int index = t->nBuckets ? t->Find(key, h) : -1;
+		if (index < 0 && (t->nItems + 1 > t->nBuckets * 3 / 4)) {
+			// Grow into a new table. It's published before 
+			// anything in it changes, so it doesn't need the seqlock.
+			t = Grow(s, t);
+		}
+		BeginWrite(s);
+		if (index >= 0)
+			t->buckets[index].value = value;
+		else
+			t->Insert(key, value, h);
+		EndWrite(s);
+	}
+
+	// Returns true if the key was found (and removed).
+	bool Remove(const K& key, V* value = 0) {
+		const uint64_t h = Hash(key);
+		Shard& s = GetShard(h);
+		std::lock_guard<std::mutex> lock(s.mutex);
+		Table* t = s.table.load(std::memory_order_relaxed);
+
+		int index = t->nBuckets ? t->Find(key, h) : -1;
+		if (index < 0)
+			return false;
+		if (value)
+			*value = t->buckets[index].value;
+		BeginWrite(s);
+		t->Erase(index);
+		EndWrite(s);
+		return true;
+	}
+
+	// Lock free.
+	bool TryGet(const K& key, V* value) const {
+		const uint64_t h = Hash(key);
+		const Shard& s = GetShard(h);
+
+		while (true) {
+			uint32_t seq = s.seq.load(std::memory_order_acquire);
+			if (seq & 1) {
+				// A writer is in this shard.
+				std::this_thread::yield();
+				continue;
+			}
+			V v = V();
+			bool found = Read(s.table.load(std::memory_order_acquire), key, h, &v);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (s.seq.load(std::memory_order_relaxed) == seq) {
+				if (found && value)
+					*value = v;
+				return found;
+			}
+		}
+	}
+
+	bool Contains(const K& key) const { return TryGet(key, 0); }
+
+	// Sum of the shard sizes; only exact if nothing is writing.
+	int Size() const {
+		int n = 0;
+		for (int i = 0; i < nShards; ++i)
+			n += shards[i].nItems.load(std::memory_order_relaxed);
+		return n;
+	}
+	bool Empty() const { return Size() == 0; }
+
+	int NumShards() const { return nShards; }
+
+	size_t MemoryInUse() const {
+		size_t mem = sizeof(Shard) * nShards;
+		for (int i = 0; i < nShards; ++i) {
+			std::lock_guard<std::mutex> lock(shards[i].mutex);
+			mem += shards[i].table.load(std::memory_order_relaxed)->AllocSize();
+			for (const Table* t : shards[i].retired)
+				mem += t->AllocSize();
+		}
+		return mem;
+	}
+
+	// Frees the buckets retired by growing. NOT safe to call
+	// while any thread may be in TryGet().
+	void Collect() {
+		for (int i = 0; i < nShards; ++i) {
+			Shard& s = shards[i];
+			std::lock_guard<std::mutex> lock(s.mutex);
+			for (Table* t : s.retired) {
+				t->Free();
+				delete t;
+			}
+			s.retired.Clear();
+		}
+	}
+
+private:
+	ConcurrentHashTable(const ConcurrentHashTable&);
+	void operator=(const ConcurrentHashTable&);
+
+	using Table = HashBuckets<K, V, H, Allocator>;
+	static uint64_t Hash(const K& k) { return Table::Hash(k, 0); }
+
+	// Each shard on its own cache lines, so that locking one
+	// doesn't slow down readers of its neighbors.
+	struct alignas(64) Shard
+	{
+		Shard() { table.store(new Table(), std::memory_order_relaxed); }
+
+		std::atomic<uint32_t> seq = { 0 };
+		std::atomic<Table*> table;
+		std::atomic<int> nItems = { 0 };
+		mutable std::mutex mutex;
+		CDynArray<Table*> retired;
+	};
+
+	Shard& GetShard(uint64_t h) const {
+		return shards[shardBits ? (h >> (64 - shardBits)) : 0];
+	}
+
+	void BeginWrite(Shard& s) {
+		s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void EndWrite(Shard& s) {
+		s.seq.store(s.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		s.nItems.store(s.table.load(std::memory_order_relaxed)->nItems, std::memory_order_relaxed);
+	}
+
+	Table* Grow(Shard& s, Table* t) {
+		Table* g = new Table();
+		g->Allocate(t->nBuckets ? t->nBuckets * 2 : Table::MIN_BUCKETS);
+		for (int i = 0; i < t->nBuckets; ++i) {
+			if (t->ctrl[i] != HashGroup::EMPTY) {
+				const typename Table::Bucket& b = t->buckets[i];
+				g->Insert(b.key, b.value, Hash(b.key));
+			}
+		}
+		s.table.store(g, std::memory_order_release);
+		if (t->nBuckets)
+			s.retired.Push(t);
+		else
+			delete t;
+		return g;
+	}
+
+	// Table::Find(), but safe against a table that is being written:
+	// the probe is bounded, and the value is copied out. The result
+	// is only meaningful if the seqlock shows no write happened.
+	static bool Read(const Table* t, const K& key, uint64_t h, V* value) {
+		if (!t->nBuckets)
+			return false;
+		const int8_t h2 = Table::H2(h);
+		uint32_t pos = t->Home(h);
+		for (int n = t->nBuckets / HashGroup::WIDTH; n >= 0; --n) {
+			HashGroup group(t->ctrl + pos);
+			for (uint32_t m = group.Match(h2); m; m &= m - 1) {
+				uint32_t index = (pos + CountTrailingZeros(m)) & t->mask;
+				if (H::Equal(t->buckets[index].key, key)) {
+					*value = t->buckets[index].value;
+					return true;
+				}
+			}
+			if (group.MatchEmpty())
+				return false;
+			pos = (pos + HashGroup::WIDTH) & t->mask;
+		}
+		return false;
+	}
+
+	int shardBits = 0;
+	int nShards = 0;
+	Shard* shards = 0;
+};
+
+template <class K, class V, class Allocator = DefaultAlloc>
+using ConcurrentIntHashTable = ConcurrentHashTable<K, V, IntHash<K>, Allocator>;
+
+}	// namespace grinliz
+#endif
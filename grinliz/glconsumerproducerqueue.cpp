@@ -20,6 +20,105 @@ void PacketQueueMT::PushMove(PacketQueue& in)
 	cond.notify_one();
 }
 
+SPSCQueue::SPSCQueue(int capacity)
+{
+	GLASSERT(capacity >= 64);
+	const uint32_t c = CeilPowerOf2(uint32_t(capacity));
+	mem = (uint8_t*)DefaultAlloc::Alloc(c, CACHE_LINE);
+	mask = c - 1;
+	(void)pad;
+}
+
+SPSCQueue::~SPSCQueue()
+{
+	DefaultAlloc::Free(mem, size_t(mask + 1), CACHE_LINE);
+}
+
+bool SPSCQueue::TryAdd(int id, const void* data, int nBytes)
+{
+	GLASSERT(id >= 0);
+	const uint64_t capacity = mask + 1;
+	const uint64_t recordSize = RecordSize(nBytes);
+	// Then it will always fit, eventually, even after a wrap.
+	GLASSERT(recordSize <= capacity / 2);
+
+	uint64_t t = writeTail;
+	uint64_t pos = t & mask;
+	const uint64_t toEnd = capacity - pos;
+	const uint64_t needed = recordSize <= toEnd ? recordSize : toEnd + recordSize;
+	if (t + needed - headCache > capacity) {
+		headCache = head.load(std::memory_order_acquire);
+		if (t + needed - headCache > capacity)
+			return false;
+	}
+	if (recordSize > toEnd) {
+		// Records are never split; skip the end of the ring.
+		Header wrap = { WRAP, 0 };
+		memcpy(mem + pos, &wrap, sizeof(Header));
+		t += toEnd;
+		pos = 0;
+	}
+	Header header = { id, nBytes };
+	memcpy(mem + pos, &header, sizeof(Header));
+	if (nBytes)
+		memcpy(mem + pos + sizeof(Header), data, nBytes);
+	writeTail = t + recordSize;
+	return true;
+}
+
+void SPSCQueue::Push(int id, const void* data, int nBytes)
+{
+	while (!TryAdd(id, data, nBytes))
+		std::this_thread::yield();
+	Publish();
+}
+
+bool SPSCQueue::TryPeek(PacketQueue::View* view)
+{
+	GLASSERT(peeked == 0);
+	while (true) {
+		if (readHead == tailCache) {
+			tailCache = tail.load(std::memory_order_acquire);
+			if (readHead == tailCache)
+				return false;
+		}
+		const uint64_t pos = readHead & mask;
+		Header header;
+		memcpy(&header, mem + pos, sizeof(Header));
+		if (header.id == WRAP) {
+			readHead += mask + 1 - pos;
+			head.store(readHead, std::memory_order_release);
+			continue;
+		}
+		view->id = header.id;
+		view->size = header.dataSize;
+		view->data = mem + pos + sizeof(Header);
+		peeked = RecordSize(header.dataSize);
+		return true;
+	}
+}
+
+int SPSCQueue::TryPop(DynMemBuf* buf)
+{
+	PacketQueue::View view;
+	if (!TryPeek(&view))
+		return -1;
+	if (buf) {
+		buf->Clear();
+		buf->Add(view.data, view.size);
+	}
+	Discard();
+	return view.id;
+}
+
+int SPSCQueue::Pop(DynMemBuf* buf)
+{
+	int id;
+	while ((id = TryPop(buf)) < 0)
+		std::this_thread::yield();
+	return id;
+}
+
 
 PacketQueueMT testQueue;
 
@@ -94,6 +193,196 @@ void Consume()
 	printf("Consumer nOdd=%d\n", nOdds);
 }
 
+static void TestSPSCQueue()
+{
+	// Variable length packets through a small ring, so it
+	// wraps and fills up all the time.
+	static const int N_PACKETS = 20'000;
+	SPSCQueue queue(1024);
+
+	std::thread producer([&queue]() {
+		uint8_t data[200];
+		int i = 0;
+		while (i < N_PACKETS) {
+			if (i % 3 == 0) {
+				int batch[10];
+				int n = Min(10, N_PACKETS - i);
+				for (int k = 0; k < n; ++k)
+					batch[k] = i + k;
+				int pushed = 0;
+				while (pushed < n) {
+					int count = queue.TryPushBatch(1, batch + pushed, n - pushed);
+					if (!count) std::this_thread::yield();
+					pushed += count;
+				}
+				i += n;
+			}
+			else {
+				int size = i % 200;
+				for (int k = 0; k < size; ++k)
+					data[k] = uint8_t(i + k);
+				queue.Push(2, data, size);
+				++i;
+			}
+		}
+		queue.Push(3);
+	});
+
+	int next = 0;
+	bool done = false;
+	while (!done) {
+		int n = queue.PopBatch(16, [&next, &done](const PacketQueue::View& view) {
+			if (view.id == 1) {
+				int v = 0;
+				GLASSERT(view.size == sizeof(int));
+				memcpy(&v, view.data, sizeof(int));
+				GLASSERT(v == next);
+				++next;
+			}
+			else if (view.id == 2) {
+				GLASSERT(view.size == next % 200);
+				GLASSERT(((uintptr_t)view.data & 7) == 0);
+				for (int k = 0; k < view.size; ++k)
+					GLASSERT(((const uint8_t*)view.data)[k] == uint8_t(next + k));
+				++next;
+			}
+			else {
+				GLASSERT(view.id == 3);
+				done = true;
+			}
+		});
+		if (!n) std::this_thread::yield();
+	}
+	producer.join();
+	GLASSERT(next == N_PACKETS);
+	GLASSERT(queue.Empty());
+
+	int v = 0;
+	int id = queue.TryPop(&v);
+	GLASSERT(id == -1);
+	bool pushed = queue.TryPush(4, 17);
+	GLASSERT(pushed);
+	id = queue.TryPop(&v);
+	GLASSERT(id == 4 && v == 17);
+	(void)id;
+	(void)pushed;
+}
+
+static void BenchSPSCQueue()
+{
+	static const int N = 1'000'000;
+	static const int BATCH = 64;
+	static const int ROUND_TRIPS = 20'000;
+
+	// Throughput: int packets from one thread to another.
+	double tMT = 0;
+	{
+		PacketQueueMT queue;
+		timePoint_t start = Now();
+		std::thread producer([&queue]() {
+			for (int i = 0; i < N; ++i)
+				queue.Push(0, i);
+			queue.Push(1);
+		});
+		DynMemBuf buf;
+		while (queue.Consume(&buf) == 0) {}
+		producer.join();
+		tMT = DeltaSeconds(start, Now());
+	}
+	double tSPSC = 0;
+	{
+		SPSCQueue queue;
+		timePoint_t start = Now();
+		std::thread producer([&queue]() {
+			for (int i = 0; i < N; ++i)
+				queue.Push(0, i);
+			queue.Push(1, 0);
+		});
+		int v = 0;
+		int id;
+		do {
+			while ((id = queue.TryPop(&v)) < 0)
+				std::this_thread::yield();
+		} while (id == 0);
+		producer.join();
+		tSPSC = DeltaSeconds(start, Now());
+	}
+	double tBatch = 0;
+	{
+		SPSCQueue queue;
+		timePoint_t start = Now();
+		std::thread producer([&queue]() {
+			int values[BATCH];
+			for (int i = 0; i < N; i += BATCH) {
+				for (int k = 0; k < BATCH; ++k)
+					values[k] = i + k;
+				int pushed = 0;
+				while (pushed < BATCH) {
+					int count = queue.TryPushBatch(0, values + pushed, BATCH - pushed);
+					if (!count) std::this_thread::yield();
+					pushed += count;
+				}
+			}
+			queue.Push(1);
+		});
+		bool done = false;
+		int64_t sum = 0;
+		while (!done) {
+			int n = queue.PopBatch(BATCH, [&done, &sum](const PacketQueue::View& view) {
+				if (view.id == 0) sum += *(const int*)view.data;
+				else done = true;
+			});
+			if (!n) std::this_thread::yield();
+		}
+		producer.join();
+		tBatch = DeltaSeconds(start, Now());
+	}
+	printf("Queue throughput, %d packets (Mpackets/s): PacketQueueMT=%.1f SPSCQueue=%.1f SPSCQueue batch %d=%.1f\n",
+		N, N / tMT * 1e-6, N / tSPSC * 1e-6, BATCH, N / tBatch * 1e-6);
+
+	// Latency: a packet there and back.
+	double rtMT = 0;
+	{
+		PacketQueueMT ping, pong;
+		std::thread echo([&ping, &pong]() {
+			DynMemBuf buf;
+			for (int i = 0; i < ROUND_TRIPS; ++i) {
+				ping.Consume(&buf);
+				pong.Push(0);
+			}
+		});
+		DynMemBuf buf;
+		timePoint_t start = Now();
+		for (int i = 0; i < ROUND_TRIPS; ++i) {
+			ping.Push(0);
+			pong.Consume(&buf);
+		}
+		rtMT = DeltaSeconds(start, Now());
+		echo.join();
+	}
+	double rtSPSC = 0;
+	{
+		SPSCQueue ping, pong;
+		std::thread echo([&ping, &pong]() {
+			for (int i = 0; i < ROUND_TRIPS; ++i) {
+				while (ping.TryPop((DynMemBuf*)0) < 0)
+					std::this_thread::yield();
+				pong.Push(0);
+			}
+		});
+		timePoint_t start = Now();
+		for (int i = 0; i < ROUND_TRIPS; ++i) {
+			ping.Push(0);
+			while (pong.TryPop((DynMemBuf*)0) < 0)
+				std::this_thread::yield();
+		}
+		rtSPSC = DeltaSeconds(start, Now());
+		echo.join();
+	}
+	printf("Queue round trip latency (us): PacketQueueMT=%.2f SPSCQueue=%.2f\n",
+		rtMT * 1e6 / ROUND_TRIPS, rtSPSC * 1e6 / ROUND_TRIPS);
+}
+
 void grinliz::ConsumerProducerQueueTest(int seed)
 {
 	// Single producer
@@ -148,4 +437,7 @@ void grinliz::ConsumerProducerQueueTest(int seed)
 	}
 	tt = totalTime.load();
 	printf("Ave multi-threaded queue time=%lld millis\n", tt / N);
+
+	TestSPSCQueue();
+	BenchSPSCQueue();
 }
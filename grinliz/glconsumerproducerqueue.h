@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <vector>
@@ -64,4 +65,141 @@ namespace grinliz {
         grinliz::PacketQueue queue;
         PacketQueue cache;
     };
+
+    // A lock free queue for exactly one producer thread and one
+    // consumer thread. The packets have the PacketQueue format (an
+    // integer id and a payload) and are stored in a ring of
+    // 'capacity' bytes, a power of 2. Payloads are 8 byte aligned.
+    //
+    // Push is non-blocking (TryPush fails if the ring is full).
+    // Pop is non-blocking (TryPop returns -1 if the ring is empty).
+    // There's no condition variable; a consumer that has nothing
+    // to do either polls or spins on Pop, which yields.
+    //
+    // TryAdd() writes a packet but doesn't make it visible until
+    // Publish(), so a batch only costs one atomic store. PopBatch()
+    // is the same on the consumer side.
+    //
+    class SPSCQueue
+    {
+    public:
+        SPSCQueue(int capacity = 64 * 1024);
+        ~SPSCQueue();
+
+        // --- Producer thread --- //
+        bool TryAdd(int id, const void* data, int nBytes);
+        void Publish() { tail.store(writeTail, std::memory_order_release); }
+
+        bool TryPush(int id, const void* data, int nBytes) {
+            if (!TryAdd(id, data, nBytes))
+                return false;
+            Publish();
+            return true;
+        }
+        template<class T>
+        bool TryPush(int id, const T& data) { return TryPush(id, &data, sizeof(data)); }
+
+        // Spins until there is space.
+        void Push(int id, const void* data, int nBytes);
+        void Push(int id) { Push(id, 0, 0); }
+        template<class T>
+        void Push(int id, const T& data) { Push(id, &data, sizeof(data)); }
+
+        // Pushes as many of the 'n' items as fit, as one batch, and
+        // returns how many that was.
+        template<class T>
+        int TryPushBatch(int id, const T* items, int n) {
+            int count = 0;
+            while (count < n && TryAdd(id, items + count, sizeof(T)))
+                ++count;
+            if (count)
+                Publish();
+            return count;
+        }
+
+        // --- Consumer thread --- //
+        // The front packet, in place; false if the ring is empty.
+        bool TryPeek(PacketQueue::View* view);
+        // Removes the front packet.
+        void Discard() { 
+            GLASSERT(peeked);
+            readHead += peeked;
+            peeked = 0;
+            head.store(readHead, std::memory_order_release);
+        }
+
+        // Returns the id of the packet, or -1 if empty.
+        int TryPop(DynMemBuf* buf);
+        template<class T>
+        int TryPop(T* t) {
+            PacketQueue::View view;
+            if (!TryPeek(&view))
+                return -1;
+            GLASSERT(view.size == sizeof(T));
+            memcpy(t, view.data, sizeof(T));
+            Discard();
+            return view.id;
+        }
+
+        // Spins until there is a packet.
+        int Pop(DynMemBuf* buf);
+
+        // Calls func(const PacketQueue::View&) for up to 'n' packets,
+        // then frees them all at once. Returns the number of packets.
+        template<class Func>
+        int PopBatch(int n, Func func) {
+            int count = 0;
+            PacketQueue::View view;
+            while (count < n && TryPeek(&view)) {
+                func(view);
+                readHead += peeked;
+                peeked = 0;
+                ++count;
+            }
+            if (count)
+                head.store(readHead, std::memory_order_release);
+            return count;
+        }
+
+        // Approximate, unless called from one of the two threads
+        // while the other is idle.
+        bool Empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+        int Capacity() const { return int(mask + 1); }
+
+    private:
+        SPSCQueue(const SPSCQueue&);
+        void operator=(const SPSCQueue&);
+
+        struct Header {
+            int id;
+            int dataSize;
+        };
+        static constexpr int WRAP = -1;     // id that sends the reader back to the start
+        static constexpr int ALIGN = 8;
+        static constexpr int CACHE_LINE = 64;
+        static uint64_t RecordSize(int nBytes) {
+            return sizeof(Header) + ((uint64_t(nBytes) + ALIGN - 1) & ~uint64_t(ALIGN - 1));
+        }
+
+        // Read only, after construction.
+        uint8_t* mem = 0;
+        uint64_t mask = 0;
+
+        // The indices count bytes and never wrap; the position 
+        // in the ring is index & mask. Each side keeps its own
+        // index and a copy of the other's on its cache line, so 
+        // the line of the other side is only read when the copy
+        // says the ring is full (or empty).
+        alignas(CACHE_LINE) std::atomic<uint64_t> tail{ 0 };
+        uint64_t writeTail = 0;
+        uint64_t headCache = 0;
+
+        alignas(CACHE_LINE) std::atomic<uint64_t> head{ 0 };
+        uint64_t readHead = 0;
+        uint64_t tailCache = 0;
+        uint64_t peeked = 0;                // size of the peeked record
+        char pad[CACHE_LINE - 4 * sizeof(uint64_t)];
+    };
 }
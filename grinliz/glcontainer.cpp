@@ -24,13 +24,156 @@ distribution.
 
 #include "glcontainer.h"
 #include "glrandom.h"
+#include "glperformance.h"
+
+#include <memory>
+#include <float.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace grinliz;
 
+// Size of a ring buffer mapping must be a multiple of this.
+static size_t MirrorGranularity()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwAllocationGranularity;
+#else
+	return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Maps 'size' bytes of memory twice, back to back, so that
+// p[i] and p[i + size] are the same byte. Returns null on failure.
+static uint8_t* MirrorAlloc(size_t size)
+{
+#ifdef _WIN32
+	HANDLE m = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), 0);
+	if (!m) return 0;
+	uint8_t* p = 0;
+	// Find a free range, and map into it. Another thread can take the
+	// range in between, so retry a few times.
+	for (int i = 0; i < 8 && !p; ++i) {
+		uint8_t* addr = (uint8_t*)VirtualAlloc(0, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+		if (!addr) break;
+		VirtualFree(addr, 0, MEM_RELEASE);
+		void* a = MapViewOfFileEx(m, FILE_MAP_ALL_ACCESS, 0, 0, size, addr);
+		void* b = a ? MapViewOfFileEx(m, FILE_MAP_ALL_ACCESS, 0, 0, size, addr + size) : 0;
+		if (a && b) {
+			p = addr;
+		}
+		else if (a) {
+			UnmapViewOfFile(a);
+		}
+	}
+	CloseHandle(m);	// the views keep the mapping
+	return p;
+#else
+#if defined(__linux__)
+	int fd = memfd_create("grinliz-ring", 0);
+#else
+	static std::atomic<int> uid(0);
+	char name[64];
+	snprintf(name, 64, "/grinliz-ring-%d-%d", int(getpid()), uid++);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0) shm_unlink(name);
+#endif
+	if (fd < 0) return 0;
+	uint8_t* p = 0;
+	if (ftruncate(fd, off_t(size)) == 0) {
+		void* addr = mmap(0, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr != MAP_FAILED) {
+			p = (uint8_t*)addr;
+			if (mmap(p, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+				|| mmap(p + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+			{
+				munmap(addr, size * 2);
+				p = 0;
+			}
+		}
+	}
+	close(fd);	// the mappings keep the memory
+	return p;
+#endif
+}
+
+static void MirrorFree(uint8_t* p, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(p);
+	UnmapViewOfFile(p + size);
+#else
+	munmap(p, size * 2);
+#endif
+}
+
+bool DynMemBuf::EnableRing()
+{
+	GLASSERT(Empty());
+	if (ring) return true;
+	size_t size = MirrorGranularity();
+	uint8_t* p = MirrorAlloc(size);
+	if (!p) return false;
+
+	Release();
+	arena = 0;
+	front = end = mem = p;
+	cap = mem + size;
+	ring = true;
+	return true;
+}
+
+void DynMemBuf::SetArena(Arena* a)
+{
+	GLASSERT(Empty() && !ring);
+	Release();
+	arena = a;
+}
+
+void DynMemBuf::Release()
+{
+	if (ring)
+		MirrorFree(mem, cap - mem);
+	else if (!arena)
+		DefaultAlloc::Free(mem, cap - mem, MALLOC_ALIGN);
+	mem = front = end = cap = 0;
+}
+
 void DynMemBuf::EnsureCap(size_t s) {
 	static constexpr size_t MIN_ALLOCATE = sizeof(void*) * 4;
 
 	intptr_t size = end - front;
+	if (ring) {
+		// Wrapped data is contiguous, so only grow when it doesn't fit.
+		size_t capacity = cap - mem;
+		if (s <= capacity) return;
+		while (capacity < s)
+			capacity *= 2;
+		uint8_t* p = MirrorAlloc(capacity);
+		const bool mirrored = p != 0;
+		if (!mirrored) {
+			// Out of address space (or mappings); drop back to 
+			// the default mode, in plain memory.
+			p = (uint8_t*)DefaultAlloc::Alloc(capacity, MALLOC_ALIGN);
+		}
+		memcpy(p, front, size);
+		MirrorFree(mem, cap - mem);
+		ring = mirrored;
+		front = mem = p;
+		end = front + size;
+		cap = mem + capacity;
+		return;
+	}
 	if (front + s > cap) {
 		if (front > mem) {
 			std::memmove(mem, front, end - front);
@@ -40,7 +183,10 @@ void DynMemBuf::EnsureCap(size_t s) {
 		if (mem + s > cap) {
 			size_t allocate = grinliz::CeilPowerOf2(uint32_t(s));
 			if (allocate < MIN_ALLOCATE) allocate = MIN_ALLOCATE;	// we go small but not too small
-			front = mem = (uint8_t*)realloc(mem, allocate);
+			if (arena)
+				front = mem = (uint8_t*)arena->Realloc(mem, cap - mem, allocate);
+			else
+				front = mem = (uint8_t*)DefaultAlloc::Realloc(mem, cap - mem, allocate, MALLOC_ALIGN);
 			cap = mem + allocate;
 		}
 		GLASSERT(front == mem);
@@ -59,6 +205,8 @@ void DynMemBuf::Move(DynMemBuf& target)
 		Swap(target.front, front);
 		Swap(target.end, end);
 		Swap(target.cap, cap);
+		Swap(target.ring, ring);
+		Swap(target.arena, arena);
 	}
 	else {
 		// Just copy.
@@ -71,6 +219,7 @@ void DynMemBuf::Move(DynMemBuf& target)
 
 void PacketQueue::Move(PacketQueue& queue)
 {
+	GLASSERT(alignMask == queue.alignMask);
 	memBuf.Move(queue.memBuf);
 	GLASSERT(Empty());
 }
@@ -81,26 +230,46 @@ void PacketQueue::Push(int id, int size, const void* data)
 	GLASSERT(id >= 0 && id < 10000);    // sanity check
 
 	Header header = { id, size };
-	memBuf.Add(header);
+	const int headerSize = HeaderSize();
+	const size_t recordSize = RecordSize(size);
+	uint8_t* p = (uint8_t*)memBuf.AddSpace(recordSize);
+	memcpy(p, &header, sizeof(Header));
 	if (size) {
-		memBuf.Add(data, size);
+		memcpy(p + headerSize, data, size);
+	}
+	if (alignMask) {
+		// Don't leave uninitialized memory in the queue.
+		memset(p + sizeof(Header), 0, headerSize - sizeof(Header));
+		memset(p + headerSize + size, 0, recordSize - headerSize - size);
 	}
 }
 
-int PacketQueue::Pop(void* target, int targetSize)
+PacketQueue::View PacketQueue::PeekView() const
 {
 	GLASSERT(memBuf.Size() >= sizeof(Header));
 	Header header;
 	memcpy(&header, memBuf.Mem(), sizeof(Header));
 	GLASSERT(header.dataSize >= 0);
+	GLASSERT(memBuf.Size() >= RecordSize(header.dataSize));
+	View view = { header.id, header.dataSize, (const uint8_t*)memBuf.Mem() + HeaderSize() };
+	return view;
+}
+
+void PacketQueue::Discard()
+{
+	View view = PeekView();
+	memBuf.DeleteFront(RecordSize(view.size));
+}
 
-	if (header.dataSize) {
-		GLASSERT(memBuf.Size() >= sizeof(Header) + header.dataSize);
-		GLASSERT(targetSize == header.dataSize);
-		memcpy(target, (uint8_t*)memBuf.Mem() + sizeof(Header), targetSize);
+int PacketQueue::Pop(void* target, int targetSize)
+{
+	View view = PeekView();
+	if (view.size) {
+		GLASSERT(targetSize == view.size);
+		memcpy(target, view.data, targetSize);
 	}
-	memBuf.DeleteFront(header.dataSize + sizeof(Header));
-	return header.id;
+	memBuf.DeleteFront(RecordSize(view.size));
+	return view.id;
 }
 
 int PacketQueue::Peek() const
@@ -115,17 +284,12 @@ int PacketQueue::Peek() const
 int PacketQueue::Pop(DynMemBuf* target)
 {
 	target->Clear();
-	GLASSERT(memBuf.Size() >= sizeof(Header));
-	Header header;
-	memcpy(&header, memBuf.Mem(), sizeof(Header));
-	GLASSERT(header.dataSize >= 0);
-
-	if (header.dataSize) {
-		GLASSERT(memBuf.Size() >= sizeof(Header) + header.dataSize);
-		target->Add((uint8_t*)memBuf.Mem() + sizeof(Header), header.dataSize);
+	View view = PeekView();
+	if (view.size) {
+		target->Add(view.data, view.size);
 	}
-	memBuf.DeleteFront(header.dataSize + sizeof(Header));
-	return header.id;
+	memBuf.DeleteFront(RecordSize(view.size));
+	return view.id;
 }
 
 
@@ -153,9 +317,37 @@ struct Vec2 {
 	int x, y;
 };
 
+// Counts what DynArray does to its elements.
+struct Tracked {
+	static int live, copies, moves;
+	int v = 0;
+
+	Tracked(int _v = 0) : v(_v) { ++live; }
+	Tracked(const Tracked& rhs) : v(rhs.v) { ++live; ++copies; }
+	Tracked(Tracked&& rhs) : v(rhs.v) { rhs.v = -1; ++live; ++moves; }
+	~Tracked() { --live; }
+	Tracked& operator=(const Tracked& rhs) { v = rhs.v; ++copies; return *this; }
+	Tracked& operator=(Tracked&& rhs) { v = rhs.v; rhs.v = -1; ++moves; return *this; }
+	bool operator==(const Tracked& rhs) const { return v == rhs.v; }
+	bool operator<(const Tracked& rhs) const { return v < rhs.v; }
+
+	static void Reset() { copies = moves = 0; }
+};
+int Tracked::live = 0;
+int Tracked::copies = 0;
+int Tracked::moves = 0;
+
+static DynArray<Tracked> MakeTracked(int n)
+{
+	DynArray<Tracked> arr;
+	for (int i = 0; i < n; ++i)
+		arr.Emplace(i);
+	return arr;
+}
+
 struct Vec2Hash {
 	static uint32_t Hash(const Vec2& v) {
-		return v.x + (v.y << 8);
+		return uint32_t(v.x) + (uint32_t(v.y) << 8);
 	}
 	static bool Equal(const Vec2& a, const Vec2& b)  {
 		return a.x == b.x && a.y == b.y;
@@ -204,6 +396,209 @@ void grinliz::TestContainers()
 		GLASSERT(InOrder(arr.Mem(), arr.Size()));
 	}
 
+	// LowerBound, BSearch, and EytzingerArray, with long runs of duplicates.
+	{
+		static const int N = 1000;
+		int arr[N];
+		for (int i = 0; i < N; ++i) arr[i] = (i / 100) * 2;	// 0,0,...2,2,...18
+		GLASSERT(LowerBound(-1, arr, N) == 0);
+		GLASSERT(LowerBound(0, arr, N) == 0);
+		GLASSERT(LowerBound(1, arr, N) == 100);
+		GLASSERT(LowerBound(18, arr, N) == 900);
+		GLASSERT(LowerBound(19, arr, N) == N);
+		GLASSERT(LowerBound(5, arr, 0) == 0);
+		for (int v = 0; v < 20; ++v) {
+			GLASSERT(BSearch(v, arr, arr + N) == ((v & 1) ? -1 : v * 50));
+		}
+
+		for (int n = 0; n <= 70; ++n) {
+			EytzingerArray<int> ey;
+			ey.Build(arr + N - n, n);
+			for (int v = -1; v <= 19; ++v) {
+				int lb = LowerBound(v, arr + N - n, n);
+				const int* p = ey.LowerBound(v);
+				GLASSERT((lb == n) == (p == 0));
+				GLASSERT(!p || *p == arr[N - n + lb]);
+				GLASSERT((ey.Find(v) != 0) == (BSearch(v, arr + N - n, arr + N) >= 0));
+				(void)lb; (void)p;
+			}
+		}
+		EytzingerArray<int> ey;
+		ey.Build(arr, N);
+		GLASSERT(((uintptr_t)&ey[1] & 63) == sizeof(int));	// index 0 starts the cache line
+		EytzingerArray<int, AlignedAlloc<256>> ey256;
+		ey256.Build(arr, 10);
+		GLASSERT(((uintptr_t)&ey256[1] & 255) == sizeof(int));
+		GLASSERT(ey.Find(4) && *ey.Find(4) == 4);
+		GLASSERT(ey.Find(5) == 0);
+		GLASSERT(ey.LowerBound(19) == 0);
+
+		struct Pair { int key; int value; };
+		Pair pairs[N];
+		for (int i = 0; i < N; ++i) pairs[i] = { arr[i], i };
+		EytzingerArray<Pair> eyPairs;
+		eyPairs.Build(pairs, N);
+		// The first of the duplicates is found.
+		const Pair* pair = eyPairs.Find(Pair{ 6, 0 }, [](const Pair& a, const Pair& b) { return a.key < b.key; });
+		GLASSERT(pair && pair->value == 300);
+		(void)pair;
+	}
+
+	// SortedDynArray, SortedFlatMap
+	{
+		SortedDynArray<int> sorted;
+		for (int i = 0; i < 100; ++i) sorted.Add((i * 37) % 10);
+		for (int i = 0; i < 100; ++i) GLASSERT(sorted[i] == i / 10);
+
+		typedef SortedFlatMap<int, int> Map;
+		Map map;
+		map.Insert(5, 0);
+		map.Insert(1, 1);
+		map.Insert(5, 2);
+		GLASSERT(map.Size() == 3 && map[0].key == 1);
+		GLASSERT(map[1].value == 0 && map[2].value == 2);	// insertion order
+
+		Random r(3);
+		Map::Entry bulk[1000];
+		for (int i = 0; i < 1000; ++i) bulk[i] = { int(r.Rand(100)), i };
+		map.InsertBulk(bulk, 1000);
+		map.InsertBulk(bulk, 10);
+		GLASSERT(map.Size() == 1013);
+		for (int i = 1; i < map.Size(); ++i) GLASSERT(!(map[i].key < map[i - 1].key));
+
+		int first, last;
+		map.EqualRange(5, &first, &last);
+		GLASSERT(last - first >= 2);
+		GLASSERT(map[first].value == 0 && map[first + 1].value == 2);	// before bulk
+		for (int i = first; i < last; ++i) GLASSERT(map[i].key == 5);
+		GLASSERT(first == 0 || map[first - 1].key < 5);
+		GLASSERT(last == map.Size() || map[last].key > 5);
+
+		int v = -1;
+		GLASSERT(map.TryGet(5, &v) && v == 0);
+		GLASSERT(!map.TryGet(1000, &v) && map.Find(-1) < 0);
+		GLASSERT(map.LowerBound(1000) == map.Size() && map.UpperBound(-1) == 0);
+		map.Value(first) = 99;
+		GLASSERT(map[first].value == 99);
+
+		int n = map.Size();
+		int erased = map.Erase(5);
+		GLASSERT(erased == last - first && map.Size() == n - erased && map.Find(5) < 0);
+		map.Erase(0, map.LowerBound(50));
+		GLASSERT(map[0].key >= 50);
+		map.Erase(0, map.Size());
+		GLASSERT(map.Empty());
+		(void)v; (void)n; (void)erased;
+	}
+	// CDynArray copy and move
+	{
+		CDynArray<int> a;
+		for (int i = 0; i < 100; ++i) a.Push(i);
+		CDynArray<int> b(a);
+		GLASSERT(b.Size() == 100 && b[99] == 99);
+
+		const int* heap = a.Mem();
+		CDynArray<int> c(std::move(a));
+		GLASSERT(c.Mem() == heap && c.Size() == 100);
+		GLASSERT(a.Empty());
+		(void)heap;
+		a.Push(1);				// still usable
+
+		CDynArray<int> small;
+		small.Push(7);
+		c = std::move(small);	// inline memory is copied
+		GLASSERT(c.Size() == 1 && c[0] == 7 && small.Empty());
+	}
+	// SmallDynArray
+	{
+		SmallDynArray<int, 16> a;
+		const int* inside = a.Mem();
+		for (int i = 0; i < 16; ++i) a.Push(i);
+		GLASSERT(a.Mem() == inside);		// no allocation
+		a.Push(16);
+		GLASSERT(a.Mem() != inside && a[16] == 16);
+		a.FreeMem();
+		GLASSERT(a.Mem() == inside);
+		(void)inside;
+		a.Push(1);
+
+		SmallDynArray<int, 2, GrowExact> exact;
+		for (int i = 0; i < 5; ++i) exact.Push(i);
+		GLASSERT(exact.Capacity() == 5);
+		exact.Reserve(9);
+		GLASSERT(exact.Capacity() == 9);
+		GLASSERT(exact.Size() == 5 && exact[4] == 4);
+
+		SmallDynArray<int, 0, GrowGeometric<3, 2>> heap;
+		for (int i = 0; i < 100; ++i) heap.Push(i);
+		GLASSERT(heap[99] == 99);
+
+		struct alignas(16) Wide { float v[4]; };
+		SmallDynArray<Wide, 3> wide;
+		wide.PushArr(3);
+		GLASSERT((uintptr_t(wide.Mem()) & 15) == 0);
+	}
+	// DynArray
+	{
+		Tracked::Reset();
+		{
+			DynArray<Tracked> arr = MakeTracked(100);
+			GLASSERT(arr.Size() == 100 && Tracked::live == 100);
+			GLASSERT(Tracked::copies == 0);		// returned, not copied
+
+			DynArray<Tracked> copy(arr);
+			GLASSERT(Tracked::copies == 100 && Tracked::live == 200);
+
+			DynArray<Tracked> moved(std::move(arr));
+			GLASSERT(arr.Empty() && moved.Size() == 100 && Tracked::live == 200);
+			GLASSERT(Tracked::copies == 100);
+
+			// The arg refers to an element, and pushing it grows the array.
+			while (moved.Size() < moved.Capacity())
+				moved.Emplace(0);
+			moved.Push(moved[3]);
+			GLASSERT(moved.Back().v == 3);
+
+			moved.Remove(0);
+			GLASSERT(moved[0].v == 1);
+			moved.SwapRemove(0);
+			GLASSERT(moved[0].v == 3);
+			int back = moved.Pop().v;
+			GLASSERT(back == 0);		// one of the fill
+			int front = moved.PopFront().v;
+			GLASSERT(front == 3);
+			(void)back; (void)front;
+			moved.PushFront(Tracked(-5));
+			GLASSERT(moved.Front().v == -5);
+
+			copy.Reverse();
+			GLASSERT(copy[0].v == 99);
+			copy.Sort();
+			GLASSERT(copy[0].v == 0 && copy[99].v == 99);
+			GLASSERT(copy.Find(Tracked(50)) == 50);
+
+			copy = moved;
+			GLASSERT(copy.Size() == moved.Size());
+			moved.Clear();
+			GLASSERT(Tracked::live == copy.Size());
+		}
+		GLASSERT(Tracked::live == 0);
+
+		// Move only types, and relocating with memcpy.
+		DynArray<std::unique_ptr<int>> ptrs;
+		for (int i = 0; i < 20; ++i)
+			ptrs.Emplace(new int(i));
+		GLASSERT(*ptrs[19] == 19);
+		ptrs.Remove(0);
+		GLASSERT(*ptrs[0] == 1);
+
+		DynArray<DynArray<int>> nested;
+		for (int i = 0; i < 20; ++i) {
+			nested.Emplace().Push(i);
+		}
+		GLASSERT(nested[19][0] == 19);
+	}
+
 	// PacketQueue
 	{
 		PacketQueue pq;
@@ -334,6 +729,159 @@ void grinliz::TestContainers()
 		GLASSERT(pq.Empty());
 	}
 
+	// SlotMap against a hash table of handle -> value.
+	{
+		SlotMap<int> map;
+		IntHashTable<uint32_t, int> ref;
+		CDynArray<uint32_t> handles;
+		Random random(5);
+		for (int i = 0; i < 5000; ++i) {
+			if (handles.Size() && random.Rand(3) == 0) {
+				int k = random.Rand(handles.Size());
+				uint32_t h = handles[k];
+				bool removed = map.Remove(h);
+				bool again = map.Remove(h);
+				GLASSERT(removed && !again && !map.Contains(h) && map.Get(h) == 0);
+				(void)removed; (void)again;
+				ref.Remove(h);
+				handles.SwapRemove(k);
+			}
+			else {
+				uint32_t h = map.Insert(i);
+				int v = 0;
+				GLASSERT(h != 0 && !ref.TryGet(h, &v));
+				(void)v;
+				ref.Add(h, i);
+				handles.Push(h);
+			}
+		}
+		GLASSERT(map.Size() == handles.Size() && map.Size() == ref.Size());
+		for (uint32_t h : handles) {
+			GLASSERT(*map.Get(h) == ref.Get(h));
+			(void)h;
+		}
+		for (int i = 0; i < map.Size(); ++i)
+			GLASSERT(map[i] == ref.Get(map.HandleAt(i)));
+
+		uint32_t h = handles[0];
+		map.Clear();
+		GLASSERT(map.Empty() && !map.Contains(h));
+		uint32_t h2 = map.Insert(7);
+		GLASSERT(h2 != h && *map.Get(h2) == 7 && map.Get(h) == 0);
+		(void)h; (void)h2;
+
+		// Non-trivial types, and 64 bit handles.
+		SlotMap<DynArray<int>, uint64_t> arrays;
+		uint64_t a = arrays.Emplace();
+		uint64_t b = arrays.Emplace();
+		arrays.Get(a)->Push(1);
+		arrays.Get(b)->Push(2);
+		bool removedA = arrays.Remove(a);
+		GLASSERT(removedA);
+		(void)removedA;
+		GLASSERT(arrays.Size() == 1 && (*arrays.Get(b))[0] == 2);
+		GLASSERT(arrays.Get(a) == 0 && (b >> 32) == 1);
+	}
+
+	// PacketQueue views and batches, packed and aligned.
+	for (int align = 1; align <= 16; align *= 4) {
+		PacketQueue pq;
+		pq.SetAlignment(align);
+		TestA testA = { 17 };
+		TestAB testB = { 19, 42.0 };
+		for (int i = 0; i < 10; ++i) {
+			pq.Push(0, testA);
+			pq.Push(1, testB);
+			pq.Push(2, 0, 0);
+		}
+		PacketQueue::View view = pq.PeekView();
+		GLASSERT(view.id == 0 && view.size == sizeof(TestA) && ((const TestA*)view.data)->a == 17);
+		pq.Discard();
+		view = pq.PeekView();
+		GLASSERT(view.id == 1 && view.size == sizeof(TestAB));
+		if (align == 16) {
+			GLASSERT(((uintptr_t)view.data & 15) == 0);
+			GLASSERT(((const TestAB*)view.data)->b == 42.0);
+		}
+
+		int n = 0;
+		int count = pq.PopBatch(5, [&n](const PacketQueue::View& v) {
+			GLASSERT(v.id == (n + 1) % 3);
+			GLASSERT(v.size == int(v.id == 0 ? sizeof(TestA) : v.id == 1 ? sizeof(TestAB) : 0));
+			if (v.id == 1) {
+				TestAB b;
+				memcpy(&b, v.data, sizeof(b));
+				GLASSERT(b.a == 19 && b.b == 42.0);
+			}
+			++n;
+		});
+		GLASSERT(count == 5 && n == 5);
+		GLASSERT(pq.Peek() == 0);
+		pq.Push(1, testB);
+		count = pq.ForEach([&n](const PacketQueue::View&) { ++n; });
+		GLASSERT(count == 30 - 6 + 1 && n == 30);
+		GLASSERT(pq.Empty());
+		(void)count;
+		GLASSERT(pq.ForEach([](const PacketQueue::View&) {}) == 0);
+	}
+
+	// DynMemBuf ring: steady traffic wraps around without growing,
+	// and the data at the front stays contiguous.
+	{
+		DynMemBuf buf;
+		if (buf.EnableRing()) {
+			GLASSERT(buf.IsRing());
+			uint8_t data[300];
+			uint8_t check[300];
+			uint8_t next = 0;		// next byte to add
+			uint8_t expect = 0;		// next byte to delete
+			Random random(11);
+			size_t capacity = 0;
+			for (int i = 0; i < 20000; ++i) {
+				int n = random.Rand(300);
+				for (int k = 0; k < n; ++k)
+					data[k] = next++;
+				buf.Add(data, n);
+				if (i == 100) capacity = buf.Capacity();
+				GLASSERT(i <= 100 || buf.Capacity() == capacity);
+
+				while (buf.Size() > 1000) {
+					int m = Min(int(buf.Size()), int(random.Rand(300)));
+					memcpy(check, buf.Mem(), m);
+					for (int k = 0; k < m; ++k, ++expect)
+						GLASSERT(check[k] == expect);
+					buf.DeleteFront(m);
+				}
+			}
+			// Growing keeps the data, even when it has wrapped.
+			for (int k = 0; k < 300; ++k)
+				data[k] = next++;
+			while (buf.Size() < capacity * 3)
+				buf.Add(data, 300);
+			GLASSERT(buf.Capacity() > capacity);
+			GLASSERT(((const uint8_t*)buf.Mem())[0] == expect);
+		}
+	}
+	{
+		PacketQueue pq;
+		if (pq.EnableRing()) {
+			TestAB testB = { 19, 42.0 };
+			for (int i = 0; i < 5000; ++i) {
+				pq.Push(i & 7, testB);
+				if (i >= 100) {
+					GLASSERT(pq.Peek() == ((i - 100) & 7));
+					testB.a = 0;
+					int id = pq.Pop(&testB);
+					GLASSERT(id == ((i - 100) & 7) && testB.a == 19);
+					(void)id;
+				}
+			}
+			PacketQueue pq1;
+			pq.Move(pq1);
+			GLASSERT(pq.Empty() && !pq1.Empty());
+		}
+	}
+
 	// BitArray
 	{
 		BitArray<16> bit16;
@@ -419,6 +967,53 @@ void grinliz::TestContainers()
 		}
 		GLASSERT(p.Empty());
 	}
+	// IndexedPQueue, against a brute force search
+	{
+		static const int N = 200;
+		IndexedPQueue<AStarNode, 4> p4;
+		IndexedPQueue<AStarNode, 2, HashHeapIndex> p2;
+		float cost[N];
+		for (int i = 0; i < N; ++i) cost[i] = -1;	// not queued
+		Random r(7);
+
+		for (int step = 0; step < 5000; ++step) {
+			int op = r.Rand(8);
+			int i = r.Rand(N);
+			int key = i * 1000;		// sparse, for the hash index
+			if (op < 5) {
+				// Costs are unique, so both queues pop the same node.
+				AStarNode node = { key, float(r.Rand(1000) * N + i) };
+				p4.Set(node);
+				p2.Set(node);
+				cost[i] = node.cost;
+			}
+			else if (op < 6) {
+				bool queued = cost[i] >= 0;
+				bool removed4 = p4.Remove(key);
+				bool removed2 = p2.Remove(key);
+				GLASSERT(removed4 == queued && removed2 == queued);
+				(void)queued; (void)removed4; (void)removed2;
+				cost[i] = -1;
+			}
+			else if (!p4.Empty()) {
+				int best = -1;
+				for (int j = 0; j < N; ++j) {
+					if (cost[j] >= 0 && (best < 0 || cost[j] < cost[best]))
+						best = j;
+				}
+				GLASSERT(p4.Get(best * 1000)->cost == cost[best]);
+				AStarNode a = p4.Pop();
+				AStarNode b = p2.Pop();
+				GLASSERT(a.index == best * 1000 && b.index == best * 1000);
+				(void)a; (void)b;
+				cost[best] = -1;
+			}
+			GLASSERT(p4.IsHeap() && p2.IsHeap());
+			GLASSERT(p4.Size() == p2.Size());
+		}
+		p4.Clear();
+		GLASSERT(p4.Empty() && !p4.Contains(0) && p4.Get(0) == 0);
+	}
 	{
 		IntHashTable<int, int> hash;
 
@@ -485,6 +1080,152 @@ void grinliz::TestContainers()
 		GLASSERT(hash.NumDeleted() <= n);
 		GLASSERT(hash.Empty());
 	}
+	{
+		// Random add / remove against a simple truth table,
+		// with lots of collisions in the low bits.
+		static const int N = 2000;
+		IntHashTable<uint32_t, int> hash;
+		bool* truth = new bool[N]();
+		Random r(7);
+
+		for (int i = 0; i < 20'000; ++i) {
+			int k = r.Rand(N);
+			uint32_t key = uint32_t(k) << 16;
+			if (truth[k]) {
+				GLASSERT(hash.Get(key) == k);
+				hash.Remove(key);
+				truth[k] = false;
+			}
+			else {
+				hash.Add(key, k);
+				truth[k] = true;
+			}
+		}
+		int count = 0;
+		for (int k = 0; k < N; ++k) {
+			GLASSERT(hash.TryGet(uint32_t(k) << 16, 0) == truth[k]);
+			if (truth[k]) ++count;
+		}
+		GLASSERT(count == hash.Size());
+		int nIt = 0;
+		for (auto it = hash.GetIterator(); !it.Done(); it.Next()) {
+			GLASSERT(truth[it.Value()]);
+			GLASSERT(it.Key() == uint32_t(it.Value()) << 16);
+			++nIt;
+		}
+		GLASSERT(nIt == count);
+		delete[] truth;
+	}
+	{
+		// Keys that aren't integers.
+		HashTable<Vec2, int, Vec2Hash> grid;
+		for (int y = -20; y < 20; ++y) {
+			for (int x = -20; x < 20; ++x) {
+				grid.Add({ x, y }, x * 1000 + y);
+			}
+		}
+		GLASSERT(grid.Size() == 1600);
+		GLASSERT(grid.Get({ -3, 7 }) == -3000 + 7);
+		GLASSERT(!grid.TryGet({ 20, 0 }, 0));
+		grid.Remove({ 0, 0 });
+		GLASSERT(!grid.TryGet({ 0, 0 }, 0));
+
+		struct Id128 {
+			uint64_t lo, hi;
+		};
+		HashTable<Id128, int> ids;	// default BlitHash
+		for (int i = 0; i < 100; ++i) {
+			// Keys only differ in the high word.
+			ids.Add({ 0, uint64_t(i) }, i);
+		}
+		// Max values are fine; nothing is reserved.
+		ids.Add({ UINT64_MAX, UINT64_MAX }, -1);
+		GLASSERT(ids.Size() == 101);
+		for (int i = 0; i < 100; ++i) {
+			GLASSERT(ids.Get({ 0, uint64_t(i) }) == i);
+		}
+		GLASSERT(ids.Get({ UINT64_MAX, UINT64_MAX }) == -1);
+		GLASSERT(!ids.TryGet({ 1, 0 }, 0));
+
+		IntHashTable<uint8_t, int> small;
+		for (int i = 0; i < 256; ++i) {
+			small.Add(uint8_t(i), i);
+		}
+		GLASSERT(small.Size() == 256);
+		GLASSERT(small.Get(255) == 255);
+	}
+	{
+		// Incremental resize: adds, removes, and lookups while
+		// the old buckets are still being migrated.
+		static const int N = 3000;
+		IntHashTable<int, int> hash;
+		hash.SetIncrementalResize(4);
+		bool* truth = new bool[N]();
+		Random r(11);
+		bool sawMigration = false;
+
+		for (int i = 0; i < 30'000; ++i) {
+			int k = r.Rand(N);
+			if (truth[k]) {
+				int v = hash.Remove(k);
+				GLASSERT(v == -k);
+				(void)v;
+				truth[k] = false;
+			}
+			else {
+				hash.Add(k, -k);
+				truth[k] = true;
+			}
+			if (hash.Migrating()) {
+				sawMigration = true;
+				int nIt = 0;
+				for (auto it = hash.GetIterator(); !it.Done(); it.Next()) {
+					GLASSERT(truth[it.Key()]);
+					++nIt;
+				}
+				GLASSERT(nIt == hash.Size());
+			}
+			int q = r.Rand(N);
+			GLASSERT(hash.TryGet(q, 0) == truth[q]);
+			(void)q;
+		}
+		GLASSERT(sawMigration);
+		(void)sawMigration;
+		hash.SetIncrementalResize(0);
+		GLASSERT(!hash.Migrating());
+		for (int k = 0; k < N; ++k) {
+			GLASSERT(hash.TryGet(k, 0) == truth[k]);
+		}
+		delete[] truth;
+	}
+	{
+		// Batched adds and lookups, with and without migration in flight.
+		static const int N = 1000;
+		int keys[N * 2], values[N * 2], out[N * 2];
+		bool found[N * 2];
+		for (int i = 0; i < N * 2; ++i) {
+			keys[i] = i * 7;
+			values[i] = i;
+		}
+		for (int incremental = 0; incremental <= 2; incremental += 2) {
+			IntHashTable<int, int> hash;
+			hash.SetIncrementalResize(incremental);
+			hash.AddMany(keys, values, N);
+			hash.AddMany(keys, values, 3);		// duplicates replace
+			GLASSERT(hash.Size() == N);
+
+			memset(out, 0, sizeof(out));
+			int nFound = hash.FindMany(keys, N * 2, out, found);
+			GLASSERT(nFound == N);
+			for (int i = 0; i < N * 2; ++i) {
+				GLASSERT(found[i] == (i < N));
+				GLASSERT(out[i] == (i < N ? i : 0));
+			}
+			nFound = hash.FindMany(keys + N, 5, out, 0);
+			GLASSERT(nFound == 0);
+			(void)nFound;
+		}
+	}
 #if true
 	{
 		static const int N = 5000;
@@ -525,3 +1266,570 @@ void grinliz::TestContainers()
 	}
 #endif
 }
+
+
+// The IntHashTable before the control byte engine: modulo hashing,
+// linear probing one bucket at a time, keys and values together.
+// Kept only as the baseline for BenchHashTable().
+template <class K, class V>
+class LegacyIntHashTable
+{
+public:
+	~LegacyIntHashTable() { free(buckets); }
+
+	void Add(K key, const V& value)
+	{
+		if (!reallocating)
+			EnsureCap();
+		int index = FindIndex(key);
+		if (index >= 0) {
+			buckets[index].value = value;
+			return;
+		}
+		uint32_t hash = Hash(key);
+		while (true) {
+			if (hash == uint32_t(nBuckets)) hash = 0;
+			K state = buckets[hash].key;
+			if (state == UNUSED || state == DELETED) {
+				if (state == DELETED)
+					--nDeleted;
+				++nItems;
+				buckets[hash].key = key;
+				buckets[hash].value = value;
+				return;
+			}
+			++hash;
+		}
+	}
+
+	bool TryGet(K key, V* value) const {
+		int index = FindIndex(key);
+		if (index >= 0) {
+			if (value) *value = buckets[index].value;
+			return true;
+		}
+		return false;
+	}
+
+private:
+	uint32_t Hash(K k) const { return uint64_t(k) % nBuckets; }
+
+	void EnsureCap() {
+		static const int MIN_BUCKETS = 63;
+		if (!nBuckets) {
+			nBuckets = MIN_BUCKETS;
+			buckets = (Bucket*)malloc(sizeof(Bucket) * nBuckets);
+			for (int i = 0; i < nBuckets; ++i)
+				buckets[i].key = UNUSED;
+		}
+		else if ((nItems + nDeleted) >= nBuckets * 2 / 3) {
+			reallocating = true;
+			Bucket* oldBuckets = buckets;
+			int oldNBuckets = nBuckets;
+			int n = nBuckets;
+			if (nDeleted < nItems)
+				n = CeilPowerOf2(Max((nItems + nDeleted) * 2, MIN_BUCKETS)) - 3;
+			nBuckets = n;
+			nItems = 0;
+			nDeleted = 0;
+			buckets = (Bucket*)malloc(sizeof(Bucket) * nBuckets);
+			for (int i = 0; i < nBuckets; ++i)
+				buckets[i].key = UNUSED;
+			for (int i = 0; i < oldNBuckets; ++i) {
+				if (oldBuckets[i].key != UNUSED && oldBuckets[i].key != DELETED)
+					Add(oldBuckets[i].key, oldBuckets[i].value);
+			}
+			free(oldBuckets);
+			reallocating = false;
+		}
+	}
+
+	int FindIndex(K key) const
+	{
+		if (nItems == 0) return -1;
+		uint32_t hash = Hash(key);
+		while (true) {
+			if (hash == uint32_t(nBuckets))
+				hash = 0;
+			K k = buckets[hash].key;
+			if (k == key) return hash;
+			if (k == UNUSED) return -1;
+			++hash;
+		}
+	}
+
+	static constexpr K UNUSED = (std::numeric_limits<K>::max)() - 1;
+	static constexpr K DELETED = (std::numeric_limits<K>::max)() - 0;
+
+	struct Bucket {
+		K key;
+		V value;
+	};
+	int nBuckets = 0;
+	int nItems = 0;
+	int nDeleted = 0;
+	bool reallocating = false;
+	Bucket* buckets = 0;
+};
+
+
+// Keys with the high bit clear are in the table; the
+// same keys with the high bit set are guaranteed misses.
+static const uint64_t MISS_BIT = 0x8000'0000'0000'0000ULL;
+
+template<typename TABLE>
+static void BenchHashRun(const char* name, const uint64_t* keys, int n, const uint64_t* queries, int nQueries)
+{
+	TABLE* table = new TABLE();
+	timePoint_t start = Now();
+	for (int i = 0; i < n; ++i)
+		table->Add(keys[i], uint32_t(i));
+	double build = DeltaSeconds(start, Now());
+
+	// hit, miss, mixed
+	double t[3] = { 0 };
+	uint64_t check = 0;
+	for (int pass = 0; pass < 3; ++pass) {
+		start = Now();
+		for (int i = 0; i < nQueries; ++i) {
+			uint64_t k = queries[i];
+			if (pass == 1 || (pass == 2 && (i & 1)))
+				k |= MISS_BIT;
+			uint32_t v = 0;
+			if (table->TryGet(k, &v))
+				check += v;
+		}
+		t[pass] = DeltaSeconds(start, Now());
+	}
+	delete table;
+
+	const double ns = 1.0e9 / nQueries;
+	printf("  %-8s build=%7.1f ns/key  hit=%6.1f  miss=%6.1f  mixed=%6.1f ns/lookup (check=%llu)\n",
+		name, build * 1.0e9 / n, t[0] * ns, t[1] * ns, t[2] * ns, (unsigned long long)check);
+}
+
+void grinliz::BenchHashTable()
+{
+	static const int SIZES[] = { 1'000, 100'000, 10'000'000 };
+	static const int N_QUERIES = 2'000'000;
+	Random random(17);
+
+	for (int n : SIZES) {
+		uint64_t* keys = new uint64_t[n];
+		for (int i = 0; i < n; ++i) {
+			keys[i] = ((uint64_t(random.Rand()) << 32) | random.Rand()) & ~MISS_BIT;
+		}
+		uint64_t* queries = new uint64_t[N_QUERIES];
+		for (int i = 0; i < N_QUERIES; ++i) {
+			queries[i] = keys[random.Rand(n)];
+		}
+
+		printf("IntHashTable<uint64_t, uint32_t> n=%d\n", n);
+		BenchHashRun<LegacyIntHashTable<uint64_t, uint32_t>>("legacy", keys, n, queries, N_QUERIES);
+		BenchHashRun<IntHashTable<uint64_t, uint32_t>>("current", keys, n, queries, N_QUERIES);
+
+		delete[] queries;
+		delete[] keys;
+	}
+
+	// Batched lookups on a table far bigger than the last level cache.
+	{
+		static const int N = 40'000'000;
+		static const int BATCH = 1024;
+		static const int N_BATCHES = N_QUERIES / BATCH;
+		uint64_t* keys = new uint64_t[N];
+		uint32_t* values = new uint32_t[N];
+		for (int i = 0; i < N; ++i) {
+			keys[i] = (uint64_t(random.Rand()) << 32) | random.Rand();
+			values[i] = uint32_t(i);
+		}
+		uint64_t* queries = new uint64_t[N_BATCHES * BATCH];
+		for (int i = 0; i < N_BATCHES * BATCH; ++i) {
+			queries[i] = keys[random.Rand(N)];
+		}
+		uint32_t out[BATCH];
+		uint64_t check = 0;
+
+		// Grow the table first, so both runs add into the same buckets.
+		IntHashTable<uint64_t, uint32_t> table;
+		for (int i = 0; i < N; ++i)
+			table.Add(keys[i], values[i]);
+		table.Clear();
+
+		timePoint_t start = Now();
+		for (int i = 0; i < N; ++i)
+			table.Add(keys[i], values[i]);
+		double tAdd = DeltaSeconds(start, Now());
+		table.Clear();
+
+		start = Now();
+		for (int i = 0; i < N; i += BATCH)
+			table.AddMany(keys + i, values + i, Min(BATCH, N - i));
+		double tAddMany = DeltaSeconds(start, Now());
+
+		start = Now();
+		for (int b = 0; b < N_BATCHES; ++b) {
+			const uint64_t* q = queries + b * BATCH;
+			for (int i = 0; i < BATCH; ++i)
+				table.TryGet(q[i], &out[i]);
+			check += out[BATCH - 1];
+		}
+		double tGet = DeltaSeconds(start, Now());
+
+		start = Now();
+		for (int b = 0; b < N_BATCHES; ++b) {
+			table.FindMany(queries + b * BATCH, BATCH, out, 0);
+			check += out[BATCH - 1];
+		}
+		double tFindMany = DeltaSeconds(start, Now());
+
+		const double nq = double(N_BATCHES) * BATCH;
+		printf("Batched n=%d (%d MB): Add=%.0f ms AddMany=%.0f ms  TryGet=%.1f Mops/s FindMany=%.1f Mops/s (check=%llu)\n",
+			N, int(table.MemoryInUse() / (1024 * 1024)), tAdd * 1000.0, tAddMany * 1000.0,
+			nq / tGet / 1.0e6, nq / tFindMany / 1.0e6, (unsigned long long)check);
+
+		delete[] queries;
+		delete[] values;
+		delete[] keys;
+	}
+
+	// Worst case time of a single Add, with and without incremental resize.
+	{
+		static const int N = 10'000'000;
+		for (int incremental = 0; incremental <= 16; incremental += 16) {
+			IntHashTable<uint64_t, uint32_t> table;
+			table.SetIncrementalResize(incremental);
+			double worst = 0;
+			int nSlow = 0;
+			timePoint_t start = Now();
+			for (int i = 0; i < N; ++i) {
+				timePoint_t t0 = Now();
+				table.Add(HashMix64(i), uint32_t(i));
+				double d = DeltaSeconds(t0, Now());
+				if (d > worst) worst = d;
+				if (d > 0.0001) ++nSlow;
+			}
+			double total = DeltaSeconds(start, Now());
+			printf("Add %d keys, incremental=%2d: total=%.0f ms  worst Add=%.3f ms  Adds over 0.1ms=%d\n",
+				N, incremental, total * 1000.0, worst * 1000.0, nSlow);
+		}
+	}
+
+	// Grid coordinates: hand packed into a uint64_t vs. used as the key.
+	{
+		static const int SIZE = 1000;
+		IntHashTable<uint64_t, int> packed;
+		HashTable<Vec2, int> direct;
+		uint64_t check = 0;
+
+		timePoint_t start = Now();
+		for (int y = 0; y < SIZE; ++y)
+			for (int x = 0; x < SIZE; ++x)
+				packed.Add((uint64_t(uint32_t(x)) << 32) | uint32_t(y), x + y);
+		for (int i = 0; i < N_QUERIES; ++i) {
+			int x = random.Rand(SIZE), y = random.Rand(SIZE);
+			check += packed.Get((uint64_t(uint32_t(x)) << 32) | uint32_t(y));
+		}
+		double tPacked = DeltaSeconds(start, Now());
+
+		start = Now();
+		for (int y = 0; y < SIZE; ++y)
+			for (int x = 0; x < SIZE; ++x)
+				direct.Add({ x, y }, x + y);
+		for (int i = 0; i < N_QUERIES; ++i) {
+			int x = random.Rand(SIZE), y = random.Rand(SIZE);
+			check += direct.Get({ x, y });
+		}
+		double tDirect = DeltaSeconds(start, Now());
+		printf("Grid keys %dx%d + %d lookups: packed uint64_t=%.1f ms  HashTable<Vec2>=%.1f ms (check=%llu)\n",
+			SIZE, SIZE, N_QUERIES, tPacked * 1000.0, tDirect * 1000.0, (unsigned long long)check);
+	}
+}
+
+
+// BSearch before LowerBound: a branchy binary search. Kept only as the baseline for BenchSearch().
+template<typename T>
+static int LegacyBSearch(const T& t, const T* mem, const T* end)
+{
+	int low = 0;
+	int high = int(end - mem);
+	const int size = int(end - mem);
+
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (mem[mid] < t)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if ((low < size) && mem[low] == t) {
+		while (low && mem[low - 1] == t) {
+			--low;
+		}
+		return low;
+	}
+	return -1;
+}
+
+void grinliz::BenchSearch()
+{
+	static const int SIZES[] = { 1'000, 1'000'000, 32'000'000 };
+	static const int N_QUERIES = 4'000'000;
+	Random random(23);
+
+	for (int n : SIZES) {
+		uint32_t* data = new uint32_t[n];
+		for (int i = 0; i < n; ++i) data[i] = random.Rand();
+		grinliz::Sort(data, n);
+		uint32_t* queries = new uint32_t[N_QUERIES];
+		for (int i = 0; i < N_QUERIES; ++i) queries[i] = data[random.Rand(n)];
+
+		EytzingerArray<uint32_t> ey;
+		timePoint_t start = Now();
+		ey.Build(data, n);
+		double tBuild = DeltaSeconds(start, Now());
+
+		uint64_t check[3] = { 0 };
+		start = Now();
+		for (int i = 0; i < N_QUERIES; ++i)
+			check[0] += LegacyBSearch(queries[i], data, data + n);
+		double tLegacy = DeltaSeconds(start, Now());
+
+		start = Now();
+		for (int i = 0; i < N_QUERIES; ++i)
+			check[1] += BSearch(queries[i], data, data + n);
+		double tBranchless = DeltaSeconds(start, Now());
+
+		start = Now();
+		for (int i = 0; i < N_QUERIES; ++i)
+			check[2] += *ey.Find(queries[i]);
+		double tEytzinger = DeltaSeconds(start, Now());
+
+		const double ns = 1.0e9 / N_QUERIES;
+		printf("BSearch uint32_t n=%d: branchy=%.1f  branchless=%.1f  eytzinger=%.1f ns/search (build=%.1f ms) %s\n",
+			n, tLegacy * ns, tBranchless * ns, tEytzinger * ns, tBuild * 1000.0,
+			check[0] == check[1] ? "ok" : "MISMATCH");
+
+		delete[] queries;
+		delete[] data;
+	}
+
+	// Building a sorted index: one element at a time vs. in bulk.
+	{
+		static const int N_ADD = 100'000;
+		static const int N_BULK = 1'000'000;
+		SortedFlatMap<uint32_t, int>::Entry* entries = new SortedFlatMap<uint32_t, int>::Entry[N_BULK];
+		for (int i = 0; i < N_BULK; ++i) entries[i] = { random.Rand(), i };
+
+		SortedDynArray<uint32_t> sorted;
+		timePoint_t start = Now();
+		for (int i = 0; i < N_ADD; ++i) sorted.Add(entries[i].key);
+		double tAdd = DeltaSeconds(start, Now());
+
+		SortedFlatMap<uint32_t, int> map;
+		start = Now();
+		map.InsertBulk(entries, N_ADD);
+		double tBulkSmall = DeltaSeconds(start, Now());
+
+		map.Clear();
+		start = Now();
+		map.InsertBulk(entries, N_BULK);
+		double tBulk = DeltaSeconds(start, Now());
+
+		printf("Sorted index: SortedDynArray::Add n=%d %.1f ms  InsertBulk n=%d %.1f ms  n=%d %.1f ms\n",
+			N_ADD, tAdd * 1000.0, N_ADD, tBulkSmall * 1000.0, N_BULK, tBulk * 1000.0);
+		delete[] entries;
+	}
+}
+
+
+// Dijkstra on a w x w grid, where entering a cell costs 'weight'.
+template<typename QUEUE>
+static double BenchDijkstra(int w, const uint8_t* weight, float* dist)
+{
+	static const int DX[4] = { 1, -1, 0, 0 };
+	static const int DY[4] = { 0, 0, 1, -1 };
+	QUEUE* queue = new QUEUE();
+	for (int i = 0; i < w * w; ++i) dist[i] = FLT_MAX;
+
+	timePoint_t start = Now();
+	dist[0] = 0;
+	queue->Set({ 0, 0.0f });
+	while (!queue->Empty()) {
+		AStarNode node = queue->Pop();
+		int x = node.index % w;
+		int y = node.index / w;
+		for (int d = 0; d < 4; ++d) {
+			int nx = x + DX[d];
+			int ny = y + DY[d];
+			if (nx < 0 || ny < 0 || nx >= w || ny >= w) continue;
+			int n = ny * w + nx;
+			float c = node.cost + weight[n];
+			if (c < dist[n]) {
+				dist[n] = c;
+				queue->Set({ n, c });
+			}
+		}
+	}
+	double t = DeltaSeconds(start, Now());
+	delete queue;
+	return t;
+}
+
+void grinliz::BenchPQueue()
+{
+	static const int SIZES[] = { 256, 1024 };
+	Random random(31);
+
+	for (int w : SIZES) {
+		const int n = w * w;
+		uint8_t* weight = new uint8_t[n];
+		for (int i = 0; i < n; ++i) weight[i] = uint8_t(1 + random.Rand(9));
+		float* dist = new float[n];
+
+		printf("Dijkstra %dx%d grid (%d nodes) ms:", w, w, n);
+		if (w <= 256) {
+			// The linear walk in Set() is too slow for the big grid.
+			printf(" PQueue=%.1f", BenchDijkstra<PQueue<AStarNode>>(w, weight, dist) * 1000.0);
+		}
+		printf(" Indexed<2>=%.1f", BenchDijkstra<IndexedPQueue<AStarNode, 2>>(w, weight, dist) * 1000.0);
+		printf(" Indexed<4>=%.1f", BenchDijkstra<IndexedPQueue<AStarNode, 4>>(w, weight, dist) * 1000.0);
+		printf(" Indexed<4,Hash>=%.1f", BenchDijkstra<IndexedPQueue<AStarNode, 4, HashHeapIndex>>(w, weight, dist) * 1000.0);
+		printf(" (dist=%.0f)\n", dist[n - 1]);
+
+		delete[] dist;
+		delete[] weight;
+	}
+}
+
+static double BenchPacketTraffic(bool ring, int64_t* check)
+{
+	// Steady state: 7/8 of a MB queued, small packets in and out. The
+	// default mode moves the queue back whenever the front reaches
+	// the end of the 1MB buffer.
+	static const int LIVE = 7 * 1024 * 1024 / 8 / 24;
+	static const int N = 4000000;
+	PacketQueue pq;
+	if (ring && !pq.EnableRing())
+		return 0;
+
+	struct Packet { int a; int b; double c; } p = { 1, 2, 3.0 };
+	timePoint_t start = Now();
+	for (int i = 0; i < N; ++i) {
+		p.a = i;
+		pq.Push(i & 15, p);
+		if (i >= LIVE) {
+			*check += pq.Pop(&p);
+			*check += p.a;
+		}
+	}
+	return DeltaSeconds(start, Now());
+}
+
+void grinliz::BenchPacketQueue()
+{
+	int64_t check = 0;
+	double tMove = BenchPacketTraffic(false, &check);
+	double tRing = BenchPacketTraffic(true, &check);
+	printf("PacketQueue steady traffic (ms): default=%.1f ring=%.1f (check=%d)\n",
+		tMove * 1000.0, tRing * 1000.0, int(check));
+
+	// Consuming tiny packets: a copy each, vs. in place.
+	static const int N = 1000000;
+	static const int REPEAT = 10;
+	PacketQueue pq;
+	DynMemBuf buf;
+	double tPop = 0, tView = 0;
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int i = 0; i < N; ++i)
+			pq.Push(i & 7, i);
+		timePoint_t start = Now();
+		while (!pq.Empty()) {
+			int v = 0;
+			check += pq.Pop(&buf);
+			buf.Get(&v);
+			check += v;
+		}
+		tPop += DeltaSeconds(start, Now());
+
+		for (int i = 0; i < N; ++i)
+			pq.Push(i & 7, i);
+		start = Now();
+		pq.ForEach([&check](const PacketQueue::View& view) {
+			int v = 0;
+			memcpy(&v, view.data, sizeof(v));
+			check += view.id + v;
+		});
+		tView += DeltaSeconds(start, Now());
+	}
+	printf("PacketQueue consume %d packets (ms): Pop=%.2f ForEach=%.2f (check=%d)\n",
+		N, tPop * 1000.0 / REPEAT, tView * 1000.0 / REPEAT, int(check));
+}
+
+void grinliz::BenchSlotMap()
+{
+	// Entities that come and go, each accessed by id every frame:
+	// an array with an id -> index hash table, vs. a SlotMap.
+	static const int N = 100000;
+	static const int FRAMES = 20;
+	static const int CHURN = 1000;
+	struct Entity { uint32_t id; float x, y; };
+	Random random(13);
+	int64_t check = 0;
+
+	CDynArray<Entity> entities;
+	IntHashTable<uint32_t, int> index;
+	CDynArray<uint32_t> ids;
+	uint32_t nextID = 1;
+	for (int i = 0; i < N; ++i) {
+		Entity e = { nextID++, 0, 0 };
+		index.Add(e.id, entities.Size());
+		entities.Push(e);
+		ids.Push(e.id);
+	}
+	timePoint_t start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		for (int c = 0; c < CHURN; ++c) {
+			int k = random.Rand(ids.Size());
+			int i = index.Remove(ids[k]);
+			if (i != entities.Size() - 1) {
+				entities[i] = entities[entities.Size() - 1];
+				index[entities[i].id] = i;
+			}
+			entities.Pop();
+			Entity e = { nextID++, 0, 0 };
+			index.Add(e.id, entities.Size());
+			entities.Push(e);
+			ids[k] = e.id;
+		}
+		for (uint32_t id : ids) {
+			Entity& e = entities[index.Get(id)];
+			e.x += 1.0f;
+			check += int(e.x);
+		}
+	}
+	double tHash = DeltaSeconds(start, Now());
+
+	random.SetSeed(13);
+	SlotMap<Entity> map;
+	CDynArray<uint32_t> handles;
+	for (int i = 0; i < N; ++i)
+		handles.Push(map.Insert(Entity{ 0, 0, 0 }));
+	start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		for (int c = 0; c < CHURN; ++c) {
+			int k = random.Rand(handles.Size());
+			map.Remove(handles[k]);
+			handles[k] = map.Insert(Entity{ 0, 0, 0 });
+		}
+		for (uint32_t h : handles) {
+			Entity* e = map.Get(h);
+			e->x += 1.0f;
+			check += int(e->x);
+		}
+	}
+	double tSlot = DeltaSeconds(start, Now());
+
+	printf("Entity access by id, %d entities (ms/frame): array+IntHashTable=%.2f SlotMap=%.2f (check=%d)\n",
+		N, tHash * 1000.0 / FRAMES, tSlot * 1000.0 / FRAMES, int(check));
+}
@@ -31,59 +31,67 @@ distribution.
 #include <vector>
 #include <mutex>
 #include <limits>
+#include <type_traits>
+#include <utility>
 
 #include "gldebug.h"
 #include "glutil.h"
+#include "glsort.h"
+#include "glmemory.h"
 #include "SpookyV2.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GRINLIZ_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace grinliz
 {
 
 void TestContainers();
+void BenchHashTable();
+void BenchSearch();
+void BenchPQueue();
+void BenchPacketQueue();
+void BenchSlotMap();
+
+/*	Branchless lower bound: the index of the first element that is
+	not less than 't', or 'size' if there is none. The loop runs a
+	fixed log2(size) times with a conditional move instead of a
+	branch, so it doesn't pay for mispredicted comparisons. The two
+	possible next probes are prefetched. Array must be sorted!
+	func(element, t) may compare different types, so an array of
+	structs can be searched by key.
+*/
+template<typename T, typename U, typename LessFunc>
+int LowerBound(const U& t, const T* mem, int size, LessFunc func) {
+	if (size <= 0) return 0;
+	const T* base = mem;
+	int n = size;
+	while (n > 1) {
+		int half = n / 2;
+		Prefetch(base + half / 2);
+		Prefetch(base + half + half / 2);
+		base = func(base[half], t) ? base + half : base;
+		n -= half;
+	}
+	return int(base - mem) + (func(*base, t) ? 1 : 0);
+}
 
-// I'm completely intriqued by CombSort. QuickSort is
-// fast, but an intricate algorithm that is easy to
-// implement an "almost working" solution. CombSort
-// is very simple, and almost as fast.
-inline int CombSortGap( int gap ) 
-{
-	GLASSERT( (gap & 0xff000000) == 0 );
-	// shrink: 1.247
-	// 9 or 10 go to 11 (awesome)
-	//							   0  1  2  3  4  5  6  7  8  9 10 11  12  13  14  15
-	static const int table[16] = { 1, 1, 1, 2, 3, 4, 4, 5, 6, 7, 8, 8, 11, 11, 11, 12 };
-	if ( gap < 16 ) {
-		gap = table[gap];
-	}
-	else {
-		gap = (gap * 103)>>7;
-	}
-	GLASSERT( gap  > 0 );
-	return gap;
+template<typename T>
+int LowerBound(const T& t, const T* mem, int size) {
+	return grinliz::LowerBound(t, mem, size, [](const T& a, const T& b) { return a < b; });
 }
 
-// Binary Search: array must be sorted!
+// Binary Search: array must be sorted! If there are multiple
+// matches, returns the first one. Returns -1 if not found.
 template<typename T, typename LessFunc>
 int BSearch(const T& t, const T* mem, const T* end, LessFunc func) {
-    int low = 0;
-    int high = end - mem;
-    const int size = end - mem;
-
-    while (low < high) {
-        int mid = low + (high - low) / 2;
-        if(func(mem[mid], t))
-            low = mid + 1;
-        else
-            high = mid;
-    }
-    if ((low < size) && EqualFromLessThan(mem[low], t, func)) {
-        // if multiple matches, return the first.
-        while (low && EqualFromLessThan(mem[low-1], t, func)) {
-            --low;
-        }
-        return low;
-    }
-    return -1;
+	const int size = int(end - mem);
+	int low = LowerBound(t, mem, size, func);
+	if ((low < size) && !func(t, mem[low]))
+		return low;
+	return -1;
 }
 
 template<typename T>
@@ -91,40 +99,6 @@ int BSearch(const T& t, const T* mem, const T* end) {
     return grinliz::BSearch(t, mem, end, [](const T& a, const T& b) { return a < b; });
 }
 
-/*
-	::Sort(T* mem, int size);						uses operator <
-	::Sort(T* mem, int size, LessFunc func );		uses lambda function
-*/
-
-template <class T, typename LessFunc >
-inline void Sort( T* mem, int size, LessFunc lessfunc  )
-{
-	int gap = size;
-	for (;;) {
-		gap = CombSortGap(gap);
-		bool swapped = false;
-		const int end = size - gap;
-		for (int i = 0; i < end; i++) {
-			int j = i + gap;
-			if ( lessfunc(mem[j],mem[i]) ) {
-				Swap(mem[i], mem[j]);
-				swapped = true;
-			}
-		}
-		if (gap == 1 && !swapped) {
-			break;
-		}
-	}
-}
-
-
-template <typename T>
-inline void Sort(T* mem, int size) {
-	Sort(mem, size, [](const T&a, const T&b) {
-		return a < b;
-	});
-}
-
 template <typename T, typename Func >
 inline int ArrayFind(const T* mem, int size, Func func)
 {
@@ -152,35 +126,81 @@ inline int ArrayFindMax(const T* mem, int size, Func func)
 	return r;
 }
 
+/*	Growth policies for SmallDynArray. Capacity() returns the new
+	capacity, at least 'needed', for an array with 'capacity'.
+*/
+// Grows by NUM/DEN; the default doubles.
+template <int NUM = 2, int DEN = 1>
+struct GrowGeometric
+{
+	static_assert(NUM > DEN, "must grow");
+	static int Capacity(int capacity, int needed) {
+		return Max(needed, int(int64_t(capacity) * NUM / DEN));
+	}
+};
+
+// Allocates exactly what is needed. Every growth is a realloc.
+struct GrowExact
+{
+	static int Capacity(int, int needed) { return needed; }
+};
+
 /*	A dynamic array for blittable data. (No constructor / destructor / virtual.)
+	The first N elements are stored in the array itself, so a short
+	list doesn't allocate. Growth past that is set by the Growth policy,
+	and the memory comes from the Allocator policy (see glmemory.h).
 */
-template <class T>
-class CDynArray
+template <class T, int N, class Growth = GrowGeometric<>, class Allocator = DefaultAlloc>
+class SmallDynArray
 {
-    enum { CACHE = 4 };
+    enum { CACHE = N };
+	// Alignment of the memory, inline or not.
+	static constexpr size_t ALIGN = alignof(T) > Allocator::ALIGN ? alignof(T) : Allocator::ALIGN;
 public:
     typedef T ElementType;
 
-    CDynArray() : size(0), capacity(CACHE) {
+    SmallDynArray() : size(0), capacity(CACHE) {
         mem = reinterpret_cast<T*>(cache);
-        GLASSERT(CACHE_SIZE * sizeof(int) >= CACHE * sizeof(T));
     }
 
-	CDynArray(const CDynArray<T>& rhs) {
+	SmallDynArray(const SmallDynArray& rhs) : size(0), capacity(CACHE) {
+		mem = reinterpret_cast<T*>(cache);
+		*this = rhs;
+	}
+
+	// Takes the heap (or arena) memory of 'rhs', if it has any.
+	SmallDynArray(SmallDynArray&& rhs) noexcept : size(0), capacity(CACHE), arena(rhs.arena) {
 		mem = reinterpret_cast<T*>(cache);
-		for (int i = 0; i < rhs.Size(); ++i)
-			Push(rhs[i]);
+		*this = std::move(rhs);
 	}
 
-    ~CDynArray() {
+    ~SmallDynArray() {
         Clear();
 		FreeMemPtr();
     }
 
-	void operator=(const CDynArray<T>& rhs) {
+	void operator=(const SmallDynArray& rhs) {
+		if (this == &rhs) return;
 		Clear();
-		for (int i = 0; i < rhs.Size(); ++i)
-			Push(rhs[i]);
+		EnsureCap(rhs.size);
+		memcpy(mem, rhs.mem, rhs.size * sizeof(T));
+		size = rhs.size;
+	}
+
+	void operator=(SmallDynArray&& rhs) {
+		if (this == &rhs) return;
+		if (rhs.mem == reinterpret_cast<T*>(rhs.cache) || rhs.arena != arena) {
+			*this = static_cast<const SmallDynArray&>(rhs);
+		}
+		else {
+			FreeMemPtr();
+			mem = rhs.mem;
+			capacity = rhs.capacity;
+			size = rhs.size;
+			rhs.mem = reinterpret_cast<T*>(rhs.cache);
+			rhs.capacity = CACHE;
+		}
+		rhs.size = 0;
 	}
 
     T* begin() { return mem; }
@@ -282,6 +302,7 @@ public:
     }
 
     int Size() const { return size; }
+    int Capacity() const { return capacity; }
 
 	void SetSize(int n, const T& def) {
 		Clear();
@@ -289,6 +310,12 @@ public:
 			Push(def);
 	}
 
+	// Drops the elements past 'n'.
+	void Truncate(int n) {
+		GLASSERT(n >= 0 && n <= size);
+		size = n;
+	}
+
     void Clear() {
 		size = 0;
     }
@@ -297,7 +324,7 @@ public:
 		FreeMemPtr();
 		mem = reinterpret_cast<T*>(cache);
 		size = 0;
-		capacity = 0;
+		capacity = CACHE;
 	}
 
     bool Empty() const { return size == 0; }
@@ -309,17 +336,38 @@ public:
 
     void Reserve(int n) { EnsureCap(n); }
 
+	// Draws memory from 'arena' rather than the heap. Must be set before
+	// the array grows past its cache; FreeMem() hands the memory back
+	// to no one, since the arena frees it. A null arena returns to the
+	// heap. Copies of the array use the heap.
+	void SetArena(Arena* a) {
+		GLASSERT(mem == reinterpret_cast<T*>(cache));
+		arena = a;
+	}
+	Arena* GetArena() const { return arena; }
+
     void EnsureCap(int count) {
         if (count > capacity) {
-            capacity = Max(CeilPowerOf2(count), (uint32_t)CACHE_SIZE * 4);
+			int oldCapacity = capacity;
+            capacity = Growth::Capacity(capacity, count);
+            GLASSERT(capacity >= count);
 			size_t s = capacity * sizeof(T);
 			
-			if (mem == reinterpret_cast<T*>(cache)) {
-				mem = (T*) malloc(s);
+			if (arena) {
+				if (mem == reinterpret_cast<T*>(cache)) {
+					mem = (T*)arena->Alloc(s, Max(ALIGN, size_t(16)));
+					memcpy(mem, cache, size * sizeof(T));
+				}
+				else {
+					mem = (T*)arena->Realloc(mem, oldCapacity * sizeof(T), s, Max(ALIGN, size_t(16)));
+				}
+			}
+			else if (mem == reinterpret_cast<T*>(cache)) {
+				mem = (T*)Allocator::Alloc(s, ALIGN);
                 memcpy(mem, cache, size * sizeof(T));
             }
             else {
-				mem = (T*)realloc(mem, s);
+				mem = (T*)Allocator::Realloc(mem, oldCapacity * sizeof(T), s, ALIGN);
             }
         }
     }
@@ -355,8 +403,8 @@ public:
 
 protected:
 	void FreeMemPtr() {
-		if (mem != reinterpret_cast<T*>(cache)) {
-			free(mem);
+		if (mem != reinterpret_cast<T*>(cache) && !arena) {
+			Allocator::Free(mem, capacity * sizeof(T), ALIGN);
 		}
 		mem = 0;
 	}
@@ -364,12 +412,13 @@ protected:
     T* mem;
     int size;
     int capacity;
-    enum {
-        CACHE_SIZE = (CACHE * sizeof(T) + sizeof(int) - 1) / sizeof(int)
-    };
-    int cache[CACHE_SIZE];
+	Arena* arena = 0;
+    alignas(ALIGN) unsigned char cache[sizeof(T) * (N ? N : 1)];
 };
 
+template <class T, class Allocator = DefaultAlloc>
+using CDynArray = SmallDynArray<T, 4, GrowGeometric<>, Allocator>;
+
 template<typename T, typename Func>
 inline int Filter(int n, T* arr, Func keep) 
 {
@@ -390,24 +439,611 @@ inline int Filter(int n, T* arr, Func keep)
 /*
 	Sorted Array
 	Does support repeated keys. (Unlike hash table.)
+	Each Add is O(n); to load a lot of data use SortedFlatMap::InsertBulk.
 */
 template <class T>
 class SortedDynArray : public CDynArray<T>
 {
 public:
     void Add(const T& t) {
+        // After any equal elements, so they stay in the order added.
+        int i = LowerBound(t, this->mem, this->size, [](const T& a, const T& b) { return !(b < a); });
         this->EnsureCap(this->size + 1);
-
-        int i = this->size;
-        while ((i > 0) && (t < this->mem[i - 1])) {
-            this->mem[i] = this->mem[i - 1];
-            --i;
-        }
+        memmove((void*)(this->mem + i + 1), (const void*)(this->mem + i), (this->size - i) * sizeof(T));
         this->mem[i] = t;
         ++(this->size);
     }
 };
 
+/*
+	A map (or multimap - it does support repeated keys) stored as a 
+	sorted array of key/value Entries. Compact, quick to search, and
+	iterates in key order. Insert and Erase are O(n); InsertBulk sorts
+	the new entries and merges them in one pass, so loading n entries 
+	is O(n log n). Equal keys stay in the order they were inserted,
+	except within one InsertBulk batch, where the order is undefined.
+	K and V must be blittable, and K needs operator<.
+*/
+template <class K, class V>
+class SortedFlatMap
+{
+public:
+	struct Entry {
+		K key;
+		V value;
+	};
+
+	int Size() const { return entries.Size(); }
+	bool Empty() const { return entries.Empty(); }
+	void Clear() { entries.Clear(); }
+	void FreeMem() { entries.FreeMem(); }
+	void Reserve(int n) { entries.Reserve(n); }
+
+	const Entry& operator[](int i) const { return entries[i]; }
+	// The value can change; the key can't, or the order breaks.
+	V& Value(int i) { return entries[i].value; }
+
+	const Entry* begin() const { return entries.begin(); }
+	const Entry* end() const { return entries.end(); }
+
+	void Insert(const K& key, const V& value) {
+		int i = UpperBound(key);
+		entries.PushArr(1);
+		Entry* mem = entries.Mem();
+		memmove((void*)(mem + i + 1), (const void*)(mem + i), (entries.Size() - 1 - i) * sizeof(Entry));
+		mem[i].key = key;
+		mem[i].value = value;
+	}
+
+	// Adds 'n' entries, in any order.
+	void InsertBulk(const Entry* add, int n) {
+		if (n <= 0) return;
+		CDynArray<Entry> batch;
+		memcpy((void*)batch.PushArr(n), (const void*)add, n * sizeof(Entry));
+		if constexpr (std::is_arithmetic<K>::value) {
+			// Sorting by key uses the radix sort.
+			grinliz::Sort(batch.Mem(), n, [](const Entry& e) { return e.key; });
+		}
+		else {
+			grinliz::Sort(batch.Mem(), n, [](const Entry& a, const Entry& b) { return a.key < b.key; });
+		}
+
+		// Merge from the back, so it can be done in place.
+		int i = entries.Size() - 1;
+		int j = n - 1;
+		entries.PushArr(n);
+		Entry* mem = entries.Mem();
+		const Entry* b = batch.Mem();
+		for (int k = entries.Size() - 1; j >= 0; --k) {
+			if (i >= 0 && b[j].key < mem[i].key)
+				mem[k] = mem[i--];
+			else
+				mem[k] = b[j--];
+		}
+	}
+
+	// Index of the first entry with a key not less than 'key'; Size() if none.
+	int LowerBound(const K& key) const {
+		return grinliz::LowerBound(key, entries.Mem(), entries.Size(), [](const Entry& e, const K& k) { return e.key < k; });
+	}
+
+	// Index of the first entry with a key greater than 'key'; Size() if none.
+	int UpperBound(const K& key) const {
+		return grinliz::LowerBound(key, entries.Mem(), entries.Size(), [](const Entry& e, const K& k) { return !(k < e.key); });
+	}
+
+	// The entries with 'key' are [*first, *last).
+	void EqualRange(const K& key, int* first, int* last) const {
+		*first = LowerBound(key);
+		*last = UpperBound(key);
+	}
+
+	// Index of the first entry with 'key', or -1.
+	int Find(const K& key) const {
+		int i = LowerBound(key);
+		return (i < entries.Size() && !(key < entries[i].key)) ? i : -1;
+	}
+
+	bool TryGet(const K& key, V* value) const {
+		int i = Find(key);
+		if (i >= 0) {
+			*value = entries[i].value;
+			return true;
+		}
+		return false;
+	}
+
+	// Removes the entries [first, last).
+	void Erase(int first, int last) {
+		GLASSERT(first >= 0 && first <= last && last <= entries.Size());
+		Entry* mem = entries.Mem();
+		memmove((void*)(mem + first), (const void*)(mem + last), (entries.Size() - last) * sizeof(Entry));
+		entries.Truncate(entries.Size() - (last - first));
+	}
+
+	// Removes all the entries with 'key'; returns how many.
+	int Erase(const K& key) {
+		int first, last;
+		EqualRange(key, &first, &last);
+		Erase(first, last);
+		return last - first;
+	}
+
+private:
+	CDynArray<Entry> entries;
+};
+
+/*	Sorted data stored in Eytzinger (breadth first) order: the root is
+	at index 1, and the children of k are at 2k and 2k+1. A search
+	reads memory from the front of the array to the back, and the
+	descendants of k four levels down share a cache line, so they can
+	be prefetched long before they are needed. Faster than BSearch on
+	large, read-mostly tables; slower to build. T must be blittable.
+	The memory comes from the Allocator policy, aligned to at least a
+	cache line.
+*/
+template <class T, class Allocator = DefaultAlloc>
+class EytzingerArray
+{
+public:
+	EytzingerArray() {}
+	~EytzingerArray() { FreeMem(); }
+
+	EytzingerArray(const EytzingerArray&) = delete;
+	void operator=(const EytzingerArray&) = delete;
+
+	// Builds the layout from data that must be sorted.
+	void Build(const T* sorted, int n) {
+		GLASSERT(n >= 0);
+		if (n > capacity) {
+			FreeMem();
+			// Index 0 is unused; mem[0] starts a cache line.
+			mem = (T*)Allocator::Alloc(sizeof(T) * (size_t(n) + 1), ALIGN);
+			capacity = n;
+		}
+		size = n;
+		int i = 0;
+		Fill(sorted, &i, 1);
+		GLASSERT(i == n);
+	}
+
+	int Size() const { return size; }
+	bool Empty() const { return size == 0; }
+
+	// Elements in tree order; 'k' is in [1, Size()].
+	const T& operator[](int k) const { GLASSERT(k >= 1 && k <= size); return mem[k]; }
+
+	// The first element not less than 't', or null if there is none.
+	template<typename LessFunc>
+	const T* LowerBound(const T& t, LessFunc func) const {
+		int k = Descend(t, func);
+		return k ? mem + k : 0;
+	}
+
+	const T* LowerBound(const T& t) const {
+		return LowerBound(t, [](const T& a, const T& b) { return a < b; });
+	}
+
+	// The first element equal to 't', or null if there is none.
+	template<typename LessFunc>
+	const T* Find(const T& t, LessFunc func) const {
+		int k = Descend(t, func);
+		return (k && !func(t, mem[k])) ? mem + k : 0;
+	}
+
+	const T* Find(const T& t) const {
+		return Find(t, [](const T& a, const T& b) { return a < b; });
+	}
+
+private:
+	enum { 
+		CACHE_LINE = 64,
+		BLOCK = sizeof(T) < CACHE_LINE ? CACHE_LINE / sizeof(T) : 1
+	};
+	static constexpr size_t ALIGN = Allocator::ALIGN > CACHE_LINE ? Allocator::ALIGN : size_t(CACHE_LINE);
+
+	void FreeMem() {
+		if (mem)
+			Allocator::Free(mem, sizeof(T) * (size_t(capacity) + 1), ALIGN);
+		mem = 0;
+		capacity = 0;
+	}
+
+	// In order walk of the tree, taking the sorted elements in turn.
+	void Fill(const T* sorted, int* i, int k) {
+		if (k <= size) {
+			Fill(sorted, i, 2 * k);
+			mem[k] = sorted[(*i)++];
+			Fill(sorted, i, 2 * k + 1);
+		}
+	}
+
+	// Returns the tree index of the lower bound, or 0.
+	template<typename LessFunc>
+	int Descend(const T& t, LessFunc func) const {
+		uint32_t k = 1;
+		while (k <= uint32_t(size)) {
+			// May point past the end; a prefetch of a bad address is ignored.
+			Prefetch((const void*)(uintptr_t(mem) + uintptr_t(k) * BLOCK * sizeof(T)));
+			k = 2 * k + (func(mem[k], t) ? 1 : 0);
+		}
+		// The path went right (less) until it turned left for the last
+		// time; undo those right turns and the final left turn.
+		k >>= CountTrailingZeros(~k) + 1;
+		return int(k);
+	}
+
+	T* mem = 0;
+	int size = 0;
+	int capacity = 0;
+};
+
+
+/*	True if a T can be moved to a new address with memcpy, leaving
+	nothing to destroy at the old one. That's any trivially copyable
+	type, and types that only own heap memory (a unique_ptr, a 
+	DynArray) - those can be added with a specialization.
+*/
+template <class T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+/*	A dynamic array for any type. Elements are constructed, destroyed,
+	copied, and moved properly. (CDynArray is the array for blittable
+	data.)
+
+	Moving a DynArray is O(1), so it can be returned from a function 
+	without a copy. When the array grows, the elements are relocated
+	with memcpy if T IsTriviallyRelocatable, else move constructed.
+	The memory comes from the Allocator policy (see glmemory.h).
+*/
+template <class T, class Allocator = DefaultAlloc>
+class DynArray
+{
+public:
+	typedef T ElementType;
+
+	DynArray() {}
+	DynArray(const DynArray& rhs) { *this = rhs; }
+	DynArray(DynArray&& rhs) { *this = std::move(rhs); }
+
+	~DynArray() {
+		Clear();
+		Allocator::Free(mem, capacity * sizeof(T), alignof(T));
+	}
+
+	void operator=(const DynArray& rhs) {
+		if (this == &rhs) return;
+		Clear();
+		EnsureCap(rhs.size);
+		for (int i = 0; i < rhs.size; ++i)
+			new (mem + i) T(rhs.mem[i]);
+		size = rhs.size;
+	}
+
+	void operator=(DynArray&& rhs) {
+		if (this == &rhs) return;
+		Clear();
+		Allocator::Free(mem, capacity * sizeof(T), alignof(T));
+		mem = rhs.mem;
+		size = rhs.size;
+		capacity = rhs.capacity;
+		rhs.mem = 0;
+		rhs.size = rhs.capacity = 0;
+	}
+
+	T* begin() { return mem; }
+	const T* begin() const { return mem; }
+	T* end() { return mem + size; }
+	const T* end() const { return mem + size; }
+
+	T& operator[](int i) { GLASSERT(i >= 0 && i < size); return mem[i]; }
+	const T& operator[](int i) const { GLASSERT(i >= 0 && i < size); return mem[i]; }
+	const T& at(int i) const { GLASSERT(i >= 0 && i < size); return mem[i]; }
+
+	T& Front() { GLASSERT(size); return mem[0]; }
+	const T& Front() const { GLASSERT(size); return mem[0]; }
+	T& Back() { GLASSERT(size); return mem[size - 1]; }
+	const T& Back() const { GLASSERT(size); return mem[size - 1]; }
+
+	// Constructs the new last element in place, from 'args'.
+	// The args may refer to an element of this array.
+	template<class... Args>
+	T& Emplace(Args&&... args) {
+		if (size == capacity)
+			return GrowAndEmplace(std::forward<Args>(args)...);
+		T* t = new (mem + size) T(std::forward<Args>(args)...);
+		++size;
+		return *t;
+	}
+
+	void Push(const T& t) { Emplace(t); }
+	void Push(T&& t) { Emplace(std::move(t)); }
+
+	void PushFront(T t) {
+		Emplace(std::move(t));
+		for (int i = size - 1; i > 0; --i)
+			Swap(mem[i], mem[i - 1]);
+	}
+
+	// Adds 'count' default constructed elements, and returns the first.
+	T* PushArr(int count) {
+		EnsureCap(size + count);
+		for (int i = 0; i < count; ++i)
+			new (mem + size + i) T();
+		size += count;
+		return mem + size - count;
+	}
+
+	T Pop() {
+		GLASSERT(size > 0);
+		T temp(std::move(mem[size - 1]));
+		mem[--size].~T();
+		return temp;
+	}
+
+	T PopFront() {
+		GLASSERT(size > 0);
+		T temp(std::move(mem[0]));
+		Remove(0);
+		return temp;
+	}
+
+	void Remove(int i) {
+		GLASSERT(i >= 0 && i < size);
+		for (int j = i; j < size - 1; ++j)
+			mem[j] = std::move(mem[j + 1]);
+		mem[--size].~T();
+	}
+
+	void SwapRemove(int i) {
+		if (i < 0) {
+			GLASSERT(i == -1);
+			return;
+		}
+		GLASSERT(i < size);
+		if (i != size - 1)
+			mem[i] = std::move(mem[size - 1]);
+		mem[--size].~T();
+	}
+
+	void Reverse() {
+		for (int i = 0; i < size / 2; ++i)
+			Swap(mem[i], mem[size - 1 - i]);
+	}
+
+	int Find(const T& t) const {
+		for (int i = 0; i < size; ++i) {
+			if (mem[i] == t)
+				return i;
+		}
+		return -1;
+	}
+
+	int Size() const { return size; }
+	int Capacity() const { return capacity; }
+	bool Empty() const { return size == 0; }
+
+	void SetSize(int n, const T& def) {
+		Clear();
+		EnsureCap(n);
+		for (int i = 0; i < n; ++i)
+			new (mem + i) T(def);
+		size = n;
+	}
+
+	void Clear() {
+		if (!std::is_trivially_destructible<T>::value) {
+			for (int i = 0; i < size; ++i)
+				mem[i].~T();
+		}
+		size = 0;
+	}
+
+	void FreeMem() {
+		Clear();
+		Allocator::Free(mem, capacity * sizeof(T), alignof(T));
+		mem = 0;
+		capacity = 0;
+	}
+
+	T* Mem() { return mem; }
+	const T* Mem() const { return mem; }
+
+	void Reserve(int n) { EnsureCap(n); }
+
+	void EnsureCap(int count) {
+		if (count > capacity)
+			Reallocate(NewCapacity(count));
+	}
+
+	void Sort() { grinliz::Sort(mem, size); }
+
+	template<typename LessFunc>
+	void Sort(LessFunc func) { grinliz::Sort<T, LessFunc>(mem, size, func); }
+
+	template<typename Context, typename Func>
+	void Filter(Context context, Func func) {
+		for (int i = 0; i < size; ++i) {
+			if (!func(context, mem[i])) {
+				SwapRemove(i);
+				--i;
+			}
+		}
+	}
+
+private:
+	static int NewCapacity(int count) {
+		return int(Max(CeilPowerOf2(uint32_t(count)), uint32_t(4)));
+	}
+
+	// Moves the elements to 'dst', leaving 'src' raw memory.
+	static void Relocate(T* dst, T* src, int n) {
+		if (IsTriviallyRelocatable<T>::value) {
+			if (n) memcpy((void*)dst, (const void*)src, n * sizeof(T));
+		}
+		else {
+			for (int i = 0; i < n; ++i) {
+				new (dst + i) T(std::move(src[i]));
+				src[i].~T();
+			}
+		}
+	}
+
+	void Reallocate(int n) {
+		T* m = (T*)Allocator::Alloc(n * sizeof(T), alignof(T));
+		Relocate(m, mem, size);
+		Allocator::Free(mem, capacity * sizeof(T), alignof(T));
+		mem = m;
+		capacity = n;
+	}
+
+	// The new element is constructed before the old ones are
+	// moved, since the args may refer to one of them.
+	template<class... Args>
+	T& GrowAndEmplace(Args&&... args) {
+		const int n = NewCapacity(size + 1);
+		T* m = (T*)Allocator::Alloc(n * sizeof(T), alignof(T));
+		T* t = new (m + size) T(std::forward<Args>(args)...);
+		Relocate(m, mem, size);
+		Allocator::Free(mem, capacity * sizeof(T), alignof(T));
+		mem = m;
+		capacity = n;
+		++size;
+		return *t;
+	}
+
+	T* mem = 0;
+	int size = 0;
+	int capacity = 0;
+};
+
+template <class T, class Allocator>
+struct IsTriviallyRelocatable<DynArray<T, Allocator>> : std::true_type {};
+
+
+/*	Objects stored densely for iteration, and referenced by stable 
+	handles. A handle is a slot index in the low bits and a generation
+	in the high bits: with a uint32_t handle, 20 bits of index and 12 
+	of generation; with a uint64_t, 32 and 32. Insert, Remove and Get 
+	are O(1) with no hashing. Removing moves the last object into the 
+	hole (like SwapRemove), so indices into the dense array change, 
+	but handles don't. A removed object's handle is stale: Get() 
+	returns null. (Until the slot's generation wraps around; 4095 
+	reuses of one slot with a uint32_t handle.) 0 is never a handle.
+*/
+template<class T, class H = uint32_t>
+class SlotMap
+{
+public:
+	typedef H Handle;
+
+	SlotMap() {}
+
+	template<class... Args>
+	Handle Emplace(Args&&... args) {
+		int slot = freeSlot;
+		if (slot >= 0) {
+			freeSlot = slots[slot].dense;
+		}
+		else {
+			GLASSERT(uint64_t(slots.Size()) < INDEX_MASK);
+			slot = slots.Size();
+			Slot* s = slots.PushArr(1);
+			s->generation = 1;
+		}
+		slots[slot].dense = dense.Size();
+		dense.Emplace(std::forward<Args>(args)...);
+		denseToSlot.Push(slot);
+		return MakeHandle(slot);
+	}
+	Handle Insert(const T& t) { return Emplace(t); }
+	Handle Insert(T&& t) { return Emplace(std::move(t)); }
+
+	// Returns false if the handle is stale.
+	bool Remove(Handle h) {
+		int d = DenseIndex(h);
+		if (d < 0) return false;
+		const int slot = denseToSlot[d];
+		const int last = dense.Size() - 1;
+		if (d != last) {
+			denseToSlot[d] = denseToSlot[last];
+			slots[denseToSlot[d]].dense = d;
+		}
+		dense.SwapRemove(d);
+		denseToSlot.Pop();
+		Retire(slot);
+		return true;
+	}
+
+	// Null if the handle is stale.
+	T* Get(Handle h) { int d = DenseIndex(h); return d >= 0 ? &dense[d] : 0; }
+	const T* Get(Handle h) const { int d = DenseIndex(h); return d >= 0 ? &dense[d] : 0; }
+	bool Contains(Handle h) const { return DenseIndex(h) >= 0; }
+
+	// The index of the object in the dense array, or -1 if stale.
+	int DenseIndex(Handle h) const {
+		const uint64_t slot = uint64_t(h) & INDEX_MASK;
+		if (slot >= uint64_t(slots.Size()) || slots[int(slot)].generation != (uint64_t(h) >> INDEX_BITS))
+			return -1;
+		return slots[int(slot)].dense;
+	}
+
+	// The dense array: iterate over Mem(), [i], or begin()/end().
+	int Size() const { return dense.Size(); }
+	bool Empty() const { return dense.Empty(); }
+	T& operator[](int i) { return dense[i]; }
+	const T& operator[](int i) const { return dense[i]; }
+	T* Mem() { return dense.Mem(); }
+	const T* Mem() const { return dense.Mem(); }
+	T* begin() { return dense.begin(); }
+	T* end() { return dense.end(); }
+	const T* begin() const { return dense.begin(); }
+	const T* end() const { return dense.end(); }
+	// The handle of the object at dense index 'i'.
+	Handle HandleAt(int i) const { return MakeHandle(denseToSlot[i]); }
+
+	// Removes everything; every handle becomes stale.
+	void Clear() {
+		for (int i = 0; i < denseToSlot.Size(); ++i)
+			Retire(denseToSlot[i]);
+		dense.Clear();
+		denseToSlot.Clear();
+	}
+
+	void Reserve(int n) {
+		dense.Reserve(n);
+		denseToSlot.Reserve(n);
+		slots.Reserve(n);
+	}
+
+private:
+	static const int INDEX_BITS = sizeof(H) >= 8 ? 32 : 20;
+	static const uint64_t INDEX_MASK = (uint64_t(1) << INDEX_BITS) - 1;
+	static const uint64_t GEN_MASK = (~uint64_t(0) >> (64 - 8 * sizeof(H))) >> INDEX_BITS;
+
+	struct Slot {
+		uint32_t generation;
+		int dense;		// index in 'dense'; if free, the next free slot
+	};
+
+	Handle MakeHandle(int slot) const {
+		return Handle((uint64_t(slots[slot].generation) << INDEX_BITS) | uint64_t(slot));
+	}
+
+	void Retire(int slot) {
+		// Skip 0, so 0 is never a handle.
+		uint32_t g = uint32_t((slots[slot].generation + 1) & GEN_MASK);
+		slots[slot].generation = g ? g : 1;
+		slots[slot].dense = freeSlot;
+		freeSlot = slot;
+	}
+
+	DynArray<T> dense;
+	CDynArray<int> denseToSlot;
+	CDynArray<Slot> slots;
+	int freeSlot = -1;
+};
+
 
 /* A fixed array class for any type.
    Supports copy construction, proper destruction, etc.
@@ -469,360 +1105,700 @@ public:
 		return rst;
 	}
 
-	T Pop() {
-		GLASSERT( size > 0 );
-		return mem[--size];
-	}
+	T Pop() {
+		GLASSERT( size > 0 );
+		return mem[--size];
+	}
+
+	T PopFront() {
+		GLASSERT( size > 0 );
+		T temp = mem[0];
+		for( int i=0; i<size-1; ++i ) {
+			mem[i] = mem[i+1];
+		}
+		--size;
+		return temp;
+	}
+
+	void Crop(int maxSize) {
+		GLASSERT(maxSize >= 0);
+		if (size > maxSize) {
+			size = maxSize;
+		}
+	}
+
+	int Find( const T& key ) const { 
+		for( int i=0; i<size; ++i ) {
+			if ( mem[i] == key )
+				return i;
+		}
+		return -1;
+	}
+
+	template<typename Context, typename Func>
+	int Find(Context context, Func func) {
+		return ArrayFind(mem, size, context, func);
+	}
+
+	template<typename Context, typename Func>
+	int FindMax(Context context, Func func) {
+		return ArrayFindMax(mem, size, context, func);
+	}
+
+	int Size() const		{ return size; }
+	int Capacity() const	{ return CAPACITY; }
+	bool HasCap() const		{ return size < CAPACITY; }
+	
+	void Clear()	{ 
+		size = 0; 
+	}
+	bool Empty() const		{ return size==0; }
+	T*		 Mem() 			{ return mem; }
+	const T* Mem() const	{ return mem; }
+
+	const T* End() 			{ return mem + size; }
+	const T* End() const	{ return mem + size; }
+
+	void SwapRemove( int i ) {
+		GLASSERT( i >= 0 && i < (int)size );
+		mem[i] = mem[size-1];
+		Pop();
+	}
+
+	void Reverse() {
+		for (int i = 0; i < size / 2; ++i) {
+			Swap(&mem[i], &mem[size - 1 - i]);
+		}
+	}
+
+	template<typename Context, typename Func>
+	void Filter(Context context, Func func) {
+		for (int i = 0; i < size; ++i) {
+			if (!func(context, mem[i])) {
+				SwapRemove(i);
+				--i;
+			}
+		}
+	}
+
+	void Sort() { grinliz::Sort<T>(mem, size); }
+
+	// LessFunc returns a < b
+	template<typename LessFunc>
+	void Sort(LessFunc func) { grinliz::Sort<T, LessFunc>(mem, size, func); }
+
+private:
+	T mem[CAPACITY];
+	int size;
+};
+
+
+// A group of hash table control bytes, scanned 16 at a time. (With
+// SSE2 that is a single compare; without it a plain loop.) Each
+// control byte is EMPTY (zero) or - for a used slot - the high bit
+// plus the low 7 bits of the hash of its key. The match functions
+// return a bit mask, where bit 'i' is set if byte 'i' matched.
+struct HashGroup
+{
+	static constexpr int WIDTH = 16;
+	static constexpr int8_t EMPTY = 0;
+
+	explicit HashGroup(const int8_t* p) {
+#ifdef GRINLIZ_SSE2
+		ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+#else
+		memcpy(ctrl, p, WIDTH);
+#endif
+	}
+
+	uint32_t Match(int8_t h2) const {
+#ifdef GRINLIZ_SSE2
+		return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+#else
+		uint32_t m = 0;
+		for (int i = 0; i < WIDTH; ++i)
+			if (ctrl[i] == h2) m |= 1u << i;
+		return m;
+#endif
+	}
+
+	uint32_t MatchEmpty() const { return Match(EMPTY); }
+
+#ifdef GRINLIZ_SSE2
+	__m128i ctrl;
+#else
+	int8_t ctrl[WIDTH];
+#endif
+};
+
+
+// Hash policies for HashTable. Hash() doesn't need to be a good
+// hash - the table mixes the result - it just needs to use all
+// of the key. Equal() is key equality.
+template<typename K>
+struct IntHash
+{
+	static uint64_t Hash(K k) { return uint64_t(k); }
+	static bool Equal(K a, K b) { return a == b; }
+};
+
+// Hashes any number of bytes. Keys up to 8 bytes are used as an
+// integer (the table mixes them), keys up to 16 are folded with a
+// single mix, and longer keys go to SpookyHash.
+inline uint64_t HashBytes(const void* data, size_t n)
+{
+	if (n <= 8) {
+		uint64_t a = 0;
+		memcpy(&a, data, n);
+		return a;
+	}
+	if (n <= 16) {
+		// Two (possibly overlapping) words cover 9-16 bytes.
+		const uint8_t* p = (const uint8_t*)data;
+		uint64_t a, b;
+		memcpy(&a, p, 8);
+		memcpy(&b, p + n - 8, 8);
+		return HashMix64(a) ^ b;
+	}
+	return SpookyHash::Hash64(data, n, 0);
+}
+
+// Any blittable key, hashed and compared as raw memory. The key
+// type must not have padding bytes, since those are compared too.
+template<typename K>
+struct BlitHash
+{
+	static uint64_t Hash(const K& k) { return HashBytes(&k, sizeof(K)); }
+	static bool Equal(const K& a, const K& b) { return memcmp(&a, &b, sizeof(K)) == 0; }
+};
+
+
+/* One array of hash table buckets and its control bytes: the storage
+   and probing under HashTable, usable on its own by other tables.
+   Open addressing with linear probing over a power of 2 number of
+   buckets; see HashTable for the details. No locks, no growth.
+*/
+template <class K, class V, class H, class Allocator = DefaultAlloc>
+struct HashBuckets
+{
+	static constexpr int MIN_BUCKETS = HashGroup::WIDTH;
+
+	// The policy hash is mixed, so that sequential or strided
+	// keys don't pile up in one part of the table. The 
+	// high bits pick the bucket, the low 7 are the H2
+	// fragment stored in the control byte. The seed changes
+	// where every key goes.
+	static uint64_t Hash(const K& k, uint64_t seed) { return HashMix64(H::Hash(k) ^ seed); }
+	uint64_t Hash(const K& k) const { return Hash(k, seed); }
+	static int8_t H2(uint64_t h) { return int8_t(0x80 | (h & 0x7f)); }
+
+	struct Bucket
+	{
+		K	key;
+		V	value;
+	};
+
+	uint8_t* mem = 0;		// one allocation for the control bytes and buckets
+	int8_t* ctrl = 0;		// nBuckets + WIDTH control bytes
+	Bucket* buckets = 0;
+	int nBuckets = 0;
+	uint32_t mask = 0;
+	int nItems = 0;
+	uint64_t seed = 0;
+
+	uint32_t Home(uint64_t h) const { return uint32_t(h >> 7) & mask; }
 
-	T PopFront() {
-		GLASSERT( size > 0 );
-		T temp = mem[0];
-		for( int i=0; i<size-1; ++i ) {
-			mem[i] = mem[i+1];
-		}
-		--size;
-		return temp;
+	static size_t BucketOffset(int n) {
+		return AlignUp(size_t(n) + HashGroup::WIDTH, alignof(Bucket));
+	}
+	static size_t AlignUp(size_t s, size_t a) {
+		return (s + a - 1) & ~(a - 1);
+	}
+	static size_t AllocSize(int n) {
+		return n ? BucketOffset(n) + sizeof(Bucket) * n : 0;
 	}
+	size_t AllocSize() const { return AllocSize(nBuckets); }
 
-	void Crop(int maxSize) {
-		GLASSERT(maxSize >= 0);
-		if (size > maxSize) {
-			size = maxSize;
-		}
+	void Allocate(int n, uint64_t hashSeed = 0) {
+		GLASSERT(mem == 0);
+		GLASSERT(IsPowerOf2(n) && n >= MIN_BUCKETS);
+		nBuckets = n;
+		mask = uint32_t(n - 1);
+		nItems = 0;
+		seed = hashSeed;
+		// EMPTY is 0, so a big table comes from the OS already 
+		// cleared; there's no O(n) pass to set it up.
+		mem = (uint8_t*)Allocator::Calloc(AllocSize(), alignof(Bucket));
+		ctrl = (int8_t*)mem;
+		buckets = (Bucket*)(mem + BucketOffset(n));
 	}
 
-	int Find( const T& key ) const { 
-		for( int i=0; i<size; ++i ) {
-			if ( mem[i] == key )
-				return i;
-		}
-		return -1;
+	void Free() {
+		Allocator::Free(mem, AllocSize(), alignof(Bucket));
+		*this = HashBuckets();
 	}
 
-	template<typename Context, typename Func>
-	int Find(Context context, Func func) {
-		return ArrayFind(mem, size, context, func);
+	void Clear() {
+		if (ctrl)
+			memset(ctrl, HashGroup::EMPTY, nBuckets + HashGroup::WIDTH);
+		nItems = 0;
 	}
 
-	template<typename Context, typename Func>
-	int FindMax(Context context, Func func) {
-		return ArrayFindMax(mem, size, context, func);
+	// The control bytes are followed by a copy of the first
+	// WIDTH bytes, so a group can always be loaded from any
+	// bucket without wrapping.
+	void SetCtrl(uint32_t i, int8_t c) {
+		ctrl[i] = c;
+		if (i < uint32_t(HashGroup::WIDTH))
+			ctrl[nBuckets + i] = c;
 	}
 
-	int Size() const		{ return size; }
-	int Capacity() const	{ return CAPACITY; }
-	bool HasCap() const		{ return size < CAPACITY; }
-	
-	void Clear()	{ 
-		size = 0; 
+	// Starts loading the home bucket of 'h' into the cache. Safe on
+	// an unallocated table, since a prefetch never faults.
+	void Prefetch(uint64_t h) const {
+		uint32_t i = Home(h);
+		grinliz::Prefetch(ctrl + i);
+		grinliz::Prefetch(buckets + i);
 	}
-	bool Empty() const		{ return size==0; }
-	T*		 Mem() 			{ return mem; }
-	const T* Mem() const	{ return mem; }
 
-	const T* End() 			{ return mem + size; }
-	const T* End() const	{ return mem + size; }
+	int Find(const K& key, uint64_t h) const {
+		if (nItems == 0) return -1;
 
-	void SwapRemove( int i ) {
-		GLASSERT( i >= 0 && i < (int)size );
-		mem[i] = mem[size-1];
-		Pop();
+		const int8_t h2 = H2(h);
+		uint32_t pos = Home(h);
+		while (true) {
+			HashGroup group(ctrl + pos);
+			for (uint32_t m = group.Match(h2); m; m &= m - 1) {
+				uint32_t index = (pos + CountTrailingZeros(m)) & mask;
+				if (H::Equal(buckets[index].key, key))
+					return int(index);
+			}
+			// Linear probing: a key is never stored past
+			// an EMPTY bucket on its probe path.
+			if (group.MatchEmpty())
+				return -1;
+			pos = (pos + HashGroup::WIDTH) & mask;
+		}
 	}
 
-	void Reverse() {
-		for (int i = 0; i < size / 2; ++i) {
-			Swap(&mem[i], &mem[size - 1 - i]);
+	// Doesn't check for an existing key.
+	Bucket* Insert(const K& key, const V& value, uint64_t h) {
+		uint32_t pos = Home(h);
+		while (true) {
+			uint32_t m = HashGroup(ctrl + pos).MatchEmpty();
+			if (m) {
+				pos = (pos + CountTrailingZeros(m)) & mask;
+				break;
+			}
+			pos = (pos + HashGroup::WIDTH) & mask;
 		}
+		SetCtrl(pos, H2(h));
+		buckets[pos].key = key;
+		buckets[pos].value = value;
+		++nItems;
+		return &buckets[pos];
 	}
 
-	template<typename Context, typename Func>
-	void Filter(Context context, Func func) {
-		for (int i = 0; i < size; ++i) {
-			if (!func(context, mem[i])) {
-				SwapRemove(i);
-				--i;
+	// Backward shift deletion. Walk the run after the hole, and 
+	// move back every bucket whose home isn't between the hole
+	// and itself. The run is short at the load factors used.
+	void Erase(uint32_t hole) {
+		uint32_t j = hole;
+		while (true) {
+			j = (j + 1) & mask;
+			if (ctrl[j] == HashGroup::EMPTY)
+				break;
+			uint32_t home = Home(Hash(buckets[j].key));
+			if (((j - home) & mask) >= ((j - hole) & mask)) {
+				SetCtrl(hole, ctrl[j]);
+				buckets[hole] = buckets[j];
+				hole = j;
 			}
 		}
+		SetCtrl(hole, HashGroup::EMPTY);
+		--nItems;
 	}
+};
 
-	void Sort() { grinliz::Sort<T>(mem, size); }
 
-	// LessFunc returns a < b
-	template<typename LessFunc>
-	void Sort(LessFunc func) { grinliz::Sort<T, LessFunc>(mem, size, func); }
+/* HashTable for blittable data. (No constructor / destructor / virtual.)
+   The key can be any type with a hash policy (see IntHash, BlitHash)
+   and no key values are reserved.
 
-private:
-	T mem[CAPACITY];
-	int size;
-};
+   Open addressing with linear probing over a power of 2 number of
+   buckets. The probe state lives in a separate array of control bytes
+   (see HashGroup) so a lookup checks 16 buckets at a time and only
+   touches a bucket when the 7 bit hash fragment matches. Misses usually
+   never leave the control bytes.
 
+   Remove() uses backward shift deletion: later buckets of the probe
+   run are moved back into the hole, so no tombstones are created and
+   the table never needs cleaning.
 
-// Simple HashTable for blittable data. (No constructor / destructor / virtual.)
-template <class K, class V>
-class IntHashTable
+   By default the table grows by rehashing everything in one call. With
+   SetIncrementalResize(n) it instead keeps the old buckets around and
+   migrates 'n' of them on each Add() or Remove(), which bounds the cost
+   of any single call. Lookups check both tables while migrating.
+*/
+template <class K, class V, class H = BlitHash<K>, class Allocator = DefaultAlloc>
+class HashTable
 {
 public:
-	IntHashTable() {}
-	~IntHashTable() { 
+	HashTable() {}
+	~HashTable() { 
 		Free(); 
 	}
 
 	// Adds a key/value pair. What about duplicates? Duplicate
 	// keys aren't allowed. An old value will be deleted and replaced.
-	V& Add(K key, const V& value)
+	V& Add(const K& key, const V& value)
 	{
-		GLASSERT(key != UNUSED && key != DELETED);
-		if (!reallocating) {
-			EnsureCap();
-		}
+		return AddHashed(key, value, Hash(key));
+	}
 
-		// Existing value?
-		int index = FindIndex(key);
-		if (index >= 0) {
-			// Replace!
-			buckets[index].value = value;
-			return buckets[index].value;
-		}
-		else {
-			uint32_t hash = Hash(key);
-			while (true) {
-				if (hash == nBuckets) hash = 0;
-				K state = buckets[hash].key;
-				if (state == UNUSED || state == DELETED) {
-					if (state == DELETED)
-						--nDeleted;
-					++nItems;
-
-					buckets[hash].key = key;
-					buckets[hash].value = value;
-					return buckets[hash].value;
-				}
-				++hash;
-			}
+	// Add() for 'n' keys and values.
+	void AddMany(const K* keys, const V* values, int n) {
+		uint64_t hashes[PREFETCH_AHEAD];
+		StartBatch(keys, n, hashes);
+		for (int i = 0; i < n; ++i) {
+			AddHashed(keys[i], values[i], NextInBatch(keys, n, i, hashes));
 		}
 	}
 
-	V Remove(K key) {
-		int index = FindIndex(key);
-		GLASSERT(index >= 0);
-		// It's always okay to be DELETED; but if the next bucket is
-		// trivially UNUSED, this can be UNUSED too, since we'll
-		// never need to move to the next bucket.
-		if (index + 1 < nBuckets && buckets[index + 1].key == UNUSED) {
-			buckets[index].key = UNUSED;
-		}
-		else {
-			buckets[index].key = DELETED;
-			++nDeleted;
+	V Remove(const K& key) {
+		MigrateStep();
+
+		const uint64_t h = Hash(key);
+		Table* t = &cur;
+		int index = cur.Find(key, h);
+		if (index < 0 && old.nBuckets) {
+			t = &old;
+			index = old.Find(key, h);
 		}
-		--nItems;
-		return buckets[index].value;
+		GLASSERT(index >= 0);
+		V v = t->buckets[index].value;
+		t->Erase(index);
+		return v;
 	}
 
 	void Clear() {
-		for (int i = 0; i < nBuckets; ++i)
-			buckets[i].key = UNUSED;
-
-		nItems = 0;
-		nDeleted = 0;
+		FinishMigration();
+		cur.Clear();
 	}
 
 	void Free() {
-		free(buckets);
-		buckets = 0;
-		nBuckets = 0;
-		nItems = 0;
-		nDeleted = 0;
+		cur.Free();
+		old.Free();
+		migrate = migrateLeft = 0;
+	}
+
+	// 0 (the default) rehashes in one call when the table grows.
+	// Otherwise the number of old buckets to migrate on each
+	// Add or Remove. 2 or more keeps every call bounded. (With 1,
+	// the new table can fill before migration is done, and the
+	// rest is migrated at once.)
+	void SetIncrementalResize(int bucketsPerOp) {
+		GLASSERT(bucketsPerOp >= 0);
+		incremental = bucketsPerOp;
+		if (!incremental)
+			FinishMigration();
+	}
+	bool Migrating() const { return old.nBuckets > 0; }
+
+	// Seeds the hash, which changes the bucket every key lands in
+	// (against keys chosen to collide, or to match a stored image.)
+	// The table must be empty.
+	void SetSeed(uint64_t s) {
+		GLASSERT(Empty());
+		Free();
+		seed = s;
 	}
+	uint64_t Seed() const { return seed; }
 
-	bool TryGet(K key, V* value) const {
-		int index = FindIndex(key);
-		if (index >= 0) {
-			if (value) *value = buckets[index].value;
+	// The buckets, for code that stores or inspects them directly
+	// (see glhashimage.h.) Finishes any migration in progress.
+	const HashBuckets<K, V, H, Allocator>& Buckets() {
+		FinishMigration();
+		return cur;
+	}
+
+	bool TryGet(const K& key, V* value) const {
+		const Bucket* b = FindBucket(key, Hash(key));
+		if (b) {
+			if (value) *value = b->value;
 			return true;
 		}
 		return false;
 	}
 
-	V Get(K key) const {
-		int index = FindIndex(key);
-		if (index >= 0) {
-			return buckets[index].value;
+	// Looks up 'n' keys at once. The keys are hashed, and their
+	// buckets prefetched, a window ahead of the probes, so the cache
+	// misses of the lookups overlap rather than being paid one at a
+	// time. Worth it when the table is much bigger than the cache.
+	// 'out' is left unchanged for missing keys. 'found' may be null.
+	// Returns the number of keys found.
+	int FindMany(const K* keys, int n, V* out, bool* found) const {
+		uint64_t hashes[PREFETCH_AHEAD];
+		int nFound = 0;
+		StartBatch(keys, n, hashes);
+		for (int i = 0; i < n; ++i) {
+			const Bucket* b = FindBucket(keys[i], NextInBatch(keys, n, i, hashes));
+			if (b) {
+				out[i] = b->value;
+				++nFound;
+			}
+			if (found) found[i] = b != 0;
+		}
+		return nFound;
+	}
+
+	V Get(const K& key) const {
+		const Bucket* b = FindBucket(key, Hash(key));
+		if (b) {
+			return b->value;
 		}
 		GLASSERT(false);
 		return V();
 	}
 
-	V& operator[] (K key) {
-		int index = FindIndex(key);
-		if (index >= 0)
-			return buckets[index].value;
-		V v;
+	V& operator[] (const K& key) {
+		Bucket* b = FindBucket(key, Hash(key));
+		if (b)
+			return b->value;
+		V v = V();
 		return Add(key, v);
 	}
 
-	const V& operator[] (K key) const {
-		int index = FindIndex(key);
-		GLASSERT(index >= 0);
-		return buckets[index].value;
+	const V& operator[] (const K& key) const {
+		const Bucket* b = FindBucket(key, Hash(key));
+		GLASSERT(b);
+		return b->value;
 	}
 
-	bool Empty() const { return nItems == 0; }
-	int Size() const { return nItems; }
+	bool Empty() const { return Size() == 0; }
+	int Size() const { return cur.nItems + old.nItems; }
 	
-	int NumBuckets() const { return nBuckets; } // testing
-	int NumDeleted() const { return nDeleted; }	// testing
-	size_t MemoryInUse() const { return nBuckets * sizeof(Bucket); }
+	int NumBuckets() const { return cur.nBuckets; } // testing
+	int NumDeleted() const { return 0; }	// testing; deletion leaves no tombstones
+	size_t MemoryInUse() const { return cur.AllocSize() + old.AllocSize(); }
 
 	void Analyze(int* nDeleted, int* nUnused, int* nUsed) const 
 	{
 		*nDeleted = 0;
 		*nUnused = 0;
 		*nUsed = 0;
-		for (int i = 0; i < nBuckets; ++i) {
-			if (buckets[i].key == UNUSED) *nUnused += 1;
-			else if (buckets[i].key == DELETED) *nDeleted += 1;
+		for (int i = 0; i < cur.nBuckets; ++i) {
+			if (cur.ctrl[i] == HashGroup::EMPTY) *nUnused += 1;
 			else *nUsed += 1;
 		}
 	}
 
 	struct Iterator {
-		friend class IntHashTable<K, V>;
+		friend class HashTable;
 	public:
-		K Key() const { return table->buckets[index].key; }
-		V Value() const { return table->buckets[index].value; }
+		const K& Key() const { return t->buckets[index].key; }
+		V Value() const { return t->buckets[index].value; }
 
 		void Next() {
 			++index;
-			while (index < table->nBuckets && UnusedOrDeleted(table->buckets[index].key))
-				index++;
+			while (true) {
+				while (index < t->nBuckets && t->ctrl[index] == HashGroup::EMPTY)
+					index++;
+				if (index < t->nBuckets || t == last)
+					break;
+				// Continue with the old table, while migrating.
+				t = last;
+				index = 0;
+			}
 		}
 		bool Done() const {
-			return !table || index == table->nBuckets;
+			return !t || (t == last && index == t->nBuckets);
 		}
 
 	private:
-		const IntHashTable<K, V>* table = 0;
+		const typename HashTable::Table* t = 0;
+		const typename HashTable::Table* last = 0;
 		int index = 0;
 	};
 
 	Iterator GetIterator() const {
 		Iterator it;
 		if (!Empty()) {
-			it.table = this;
+			it.t = &cur;
+			it.last = old.nBuckets ? &old : &cur;
 			it.index = -1;
 			it.Next();
 		}
-		else {
-			it.table = 0;
-			it.index = 0;
-		}
 		return it;
 	}
 
 private:
-	IntHashTable(IntHashTable&);
-	void operator=(const IntHashTable&);
+	HashTable(HashTable&);
+	void operator=(const HashTable&);
 
-	// Since all the keys are integers, this may
-	// not really be a hash so much as spreading
-	// out the values.
-	uint32_t Hash(K k) const {
-		//return SpookyHash::Hash32(&k, sizeof(k), 37) % nBuckets;
-		return uint64_t(k) % nBuckets;
+	using Table = HashBuckets<K, V, H, Allocator>;
+	using Bucket = typename Table::Bucket;
+	static constexpr int MIN_BUCKETS = Table::MIN_BUCKETS;
+	uint64_t Hash(const K& k) const { return Table::Hash(k, seed); }
+
+	// Far enough ahead to cover memory latency; a power of 2.
+	static constexpr int PREFETCH_AHEAD = 16;
+
+	void Prefetch(uint64_t h) const {
+		cur.Prefetch(h);
+		if (old.nBuckets)
+			old.Prefetch(h);
 	}
 
-	void EnsureCap() {
-		static const int MIN_BUCKETS = 63;
-		if (!nBuckets) {
-			GLASSERT(buckets == 0);
-			nItems = nDeleted = 0;
-			nBuckets = MIN_BUCKETS;
-			buckets = (Bucket*)malloc(sizeof(Bucket) * nBuckets);
-			memset(buckets, 0, sizeof(Bucket) * nBuckets);
-			for (int i = 0; i < nBuckets; ++i)
-				buckets[i].key = UNUSED;
-		}
-		else if ((nItems + nDeleted) >= nBuckets * 2 / 3) {
-			GLASSERT(!reallocating);
-			reallocating = true;
-
-			Bucket* oldBuckets = buckets;
-			int oldNBuckets = nBuckets;
-
-			int n = nBuckets;
-			// If mostly 'deleted', don't expand, just re-distribute.
-			if (nDeleted < nItems) {
-				// Powers of 2 tend to conflict. The additional term 
-				// is used to try to get something odd or prime.
-				n = CeilPowerOf2(Max((nItems + nDeleted) * 2, MIN_BUCKETS)) - 3;
-				GLASSERT(n > nBuckets);
-			}
-			nBuckets = n;
-			nItems = 0;
-			nDeleted = 0;
-			buckets = (Bucket*)malloc(sizeof(Bucket) * nBuckets);
-			memset(buckets, 0, sizeof(Bucket) * nBuckets);
-			for (int i = 0; i < nBuckets; ++i)
-				buckets[i].key = UNUSED;
-
-			for (int i = 0; i < oldNBuckets; ++i) {
-				if (!UnusedOrDeleted(oldBuckets[i].key))
-					Add(oldBuckets[i].key, oldBuckets[i].value);
-			}
-			free(oldBuckets);
-			reallocating = false;
+	void StartBatch(const K* keys, int n, uint64_t* hashes) const {
+		for (int i = 0; i < n && i < PREFETCH_AHEAD; ++i) {
+			hashes[i] = Hash(keys[i]);
+			Prefetch(hashes[i]);
 		}
 	}
 
-	int FindIndex(K key) const
-	{
-		if (Empty()) return -1;
+	// Returns the hash of key 'i', and queues up the key
+	// PREFETCH_AHEAD after it in its place.
+	uint64_t NextInBatch(const K* keys, int n, int i, uint64_t* hashes) const {
+		const int slot = i & (PREFETCH_AHEAD - 1);
+		const uint64_t h = hashes[slot];
+		if (i + PREFETCH_AHEAD < n) {
+			hashes[slot] = Hash(keys[i + PREFETCH_AHEAD]);
+			Prefetch(hashes[slot]);
+		}
+		return h;
+	}
+
+	V& AddHashed(const K& key, const V& value, uint64_t h) {
+		MigrateStep();
+
+		// Existing value?
+		Bucket* b = FindBucket(key, h);
+		if (b) {
+			// Replace!
+			b->value = value;
+			return b->value;
+		}
+		EnsureCap();
+		return cur.Insert(key, value, h)->value;
+	}
+
+	const Bucket* FindBucket(const K& key, uint64_t h) const {
+		int index = cur.Find(key, h);
+		if (index >= 0)
+			return &cur.buckets[index];
+		if (old.nBuckets) {
+			index = old.Find(key, h);
+			if (index >= 0)
+				return &old.buckets[index];
+		}
+		return 0;
+	}
+
+	Bucket* FindBucket(const K& key, uint64_t h) {
+		return const_cast<Bucket*>(static_cast<const HashTable*>(this)->FindBucket(key, h));
+	}
 
-		uint32_t hash = Hash(key);
+	void EnsureCap() {
+		if (!cur.nBuckets) {
+			cur.Allocate(MIN_BUCKETS, seed);
+		}
+		else if (cur.nItems + 1 > cur.nBuckets * 3 / 4) {
+			// Can only happen if migrating 0 or 1 buckets per op.
+			FinishMigration();
+
+			old = cur;
+			cur = Table();
+			cur.Allocate(old.nBuckets * 2, seed);
+			BeginMigration();
+			if (!incremental)
+				FinishMigration();
+		}
+	}
+
+	// Migration walks the old table backwards, starting below an
+	// EMPTY bucket. Everything above 'migrate' (back to that start)
+	// has been moved, so the bucket being moved is always the end of
+	// its probe run; clearing it can't hide any other key, and the
+	// old table stays valid for lookups and Remove() with no shifting.
+	void BeginMigration() {
+		uint32_t pos = 0;
 		while (true) {
-			if (hash == nBuckets) 
-				hash = 0;
-			if (!UnusedOrDeleted(buckets[hash].key)) {
-				if (buckets[hash].key == key) {
-					return hash;
-				}
+			uint32_t m = HashGroup(old.ctrl + pos).MatchEmpty();
+			if (m) {
+				migrate = int((pos + CountTrailingZeros(m)) & old.mask);
+				break;
 			}
-			else if (buckets[hash].key == UNUSED) {
-				return -1;
+			pos += HashGroup::WIDTH;
+		}
+		migrateLeft = old.nBuckets;
+	}
+
+	void Migrate(int budget) {
+		while (old.nBuckets && budget-- > 0) {
+			migrate = int((migrate - 1) & old.mask);
+			if (old.ctrl[migrate] != HashGroup::EMPTY) {
+				const Bucket& b = old.buckets[migrate];
+				cur.Insert(b.key, b.value, Hash(b.key));
+				old.SetCtrl(migrate, HashGroup::EMPTY);
+				--old.nItems;
+			}
+			if (--migrateLeft == 0) {
+				GLASSERT(old.nItems == 0);
+				old.Free();
 			}
-			++hash;
 		}
-		return -1;
 	}
 
-	int nBuckets = 0;
-	int nItems = 0;
-	int nDeleted = 0;
-	bool reallocating = false;
+	void MigrateStep() {
+		if (old.nBuckets)
+			Migrate(incremental);
+	}
 
-	static constexpr K UNUSED = (std::numeric_limits<K>::max)() - 1;
-	static constexpr K DELETED = (std::numeric_limits<K>::max)() - 0;
-	static bool UnusedOrDeleted(K k) { return k == UNUSED || k == DELETED; }
+	void FinishMigration() {
+		if (old.nBuckets)
+			Migrate(migrateLeft);
+		GLASSERT(old.nBuckets == 0);
+	}
 
-	struct Bucket
-	{
-		Bucket() : key(UNUSED) {}
-		K	key;
-		V	value;
-	};
-	Bucket* buckets = 0;
+	Table cur;
+	Table old;				// only while migrating
+	int migrate = 0;		// last bucket of 'old' moved
+	int migrateLeft = 0;	// buckets of 'old' still to check
+	int incremental = 0;
+	uint64_t seed = 0;
 };
 
+// The original integer key table.
+template <class K, class V, class Allocator = DefaultAlloc>
+using IntHashTable = HashTable<K, V, IntHash<K>, Allocator>;
+
 
 // A simple class that accumulates memory to store stuff.
 // Usefu for the packet classes and such. Memory is 
 // contiguous and only the base pointer is aligned.
+//
+// By default, when the front has moved forward and more space is
+// needed, the data is moved back to the start. In ring mode (see
+// EnableRing) the memory is mapped twice, back to back, so data that
+// wraps past the end is still contiguous: Add and DeleteFront never
+// move the data, and the buffer only grows when the data doesn't fit.
 class DynMemBuf
 {
 public:
 	DynMemBuf() {}
-	~DynMemBuf() { free(mem); }
+	~DynMemBuf() { Release(); }
+
+	// Switches to ring mode; the buffer must be empty. Returns false, 
+	// and stays in the default mode, if the platform can't map the
+	// memory twice.
+	bool EnableRing();
+	bool IsRing() const { return ring; }
+
+	// Draws memory from 'arena' rather than the heap; the buffer must be
+	// empty, and not a ring. Null returns to the heap.
+	void SetArena(Arena* arena);
+	Arena* GetArena() const { return arena; }
 
 	void Add(const void* src, size_t nBytes) {
 		EnsureCap(Size() + nBytes);
@@ -834,6 +1810,14 @@ public:
 		GLASSERT(front >= mem);
 	}
 
+	// Adds 'nBytes' of space to the end, and returns it to be written.
+	void* AddSpace(size_t nBytes) {
+		EnsureCap(Size() + nBytes);
+		uint8_t* p = end;
+		end += nBytes;
+		return p;
+	}
+
 	void DeleteFront(size_t nBytes) {
 		GLASSERT(nBytes <= size_t(end - front));
 		front += nBytes;
@@ -841,6 +1825,12 @@ public:
 			front = mem;
 			end = mem;
 		}
+		else if (front >= cap) {
+			// Only in ring mode: continue in the first mapping.
+			GLASSERT(ring);
+			front -= cap - mem;
+			end -= cap - mem;
+		}
 		GLASSERT(front <= cap);
 		GLASSERT(front <= end);
 		GLASSERT(front >= mem);
@@ -867,15 +1857,22 @@ public:
 	void* Mem() { return front; }
 
 	size_t Size() const { return end - front; }
+	size_t Capacity() const { return cap - mem; }
 	bool Empty() const { return front == end; }
 	void Clear() { front = mem; end = mem; }
 
 private:
+	DynMemBuf(const DynMemBuf&);
+	void operator=(const DynMemBuf&);
+
 	void EnsureCap(size_t s);
+	void Release();
 	uint8_t* mem = 0;		// origin of memory, returned by malloc/realloc
 	uint8_t* front = 0;		// where the beginning of data is. DeleteFront may move this past 'mem'
-	uint8_t* end = 0;		// end of memory
+	uint8_t* end = 0;		// end of memory; in ring mode, may be in the second mapping
 	uint8_t* cap = 0;		// capacity of memory
+	bool ring = false;
+	Arena* arena = 0;
 };
 
 
@@ -903,7 +1900,62 @@ public:
 	int Peek() const;
 	bool Empty() const { return memBuf.Empty(); }
 
-	// Move 'this' to 'queue'.
+	// A packet, in place in the queue. 'data' is valid until 
+	// the queue is changed.
+	struct View {
+		int id;
+		int size;
+		const void* data;
+	};
+
+	// The front packet, without a copy.
+	View PeekView() const;
+	// Removes the front packet.
+	void Discard();
+
+	// Calls func(const View&) for up to 'n' packets from the front,
+	// then removes them all at once. 'func' may not change this queue.
+	// Returns the number of packets.
+	template<class Func>
+	int PopBatch(int n, Func func) {
+		const uint8_t* p = (const uint8_t*)memBuf.Mem();
+		const size_t size = memBuf.Size();
+		size_t pos = 0;
+		int count = 0;
+		while (count < n && pos < size) {
+			Header header;
+			memcpy(&header, p + pos, sizeof(Header));
+			View view = { header.id, header.dataSize, p + pos + HeaderSize() };
+			func(view);
+			pos += RecordSize(header.dataSize);
+			++count;
+		}
+		if (pos)
+			memBuf.DeleteFront(pos);
+		return count;
+	}
+
+	// PopBatch() for every packet in the queue.
+	template<class Func>
+	int ForEach(Func func) {
+		return PopBatch(std::numeric_limits<int>::max(), func);
+	}
+
+	// Pads the packets so the data is aligned to 'align' bytes (a power 
+	// of 2, up to the 16 that malloc guarantees) and can be used in 
+	// place as a struct. The default of 1 adds no padding. The queue
+	// must be empty.
+	void SetAlignment(int align) {
+		GLASSERT(Empty());
+		GLASSERT(align >= 1 && align <= 16 && IsPowerOf2(align));
+		alignMask = align - 1;
+	}
+	int Alignment() const { return alignMask + 1; }
+
+	// See DynMemBuf::EnableRing. The queue must be empty.
+	bool EnableRing() { return memBuf.EnableRing(); }
+
+	// Move 'this' to 'queue'. The alignment must match.
 	// 'this' will be empty after move.
 	void Move(PacketQueue& queue);
 
@@ -918,7 +1970,12 @@ private:
 		int id;
 		int dataSize;
 	};
+	int Pad(int n) const { return (n + alignMask) & ~alignMask; }
+	int HeaderSize() const { return Pad(int(sizeof(Header))); }
+	size_t RecordSize(int dataSize) const { return size_t(HeaderSize() + Pad(dataSize)); }
+
 	DynMemBuf memBuf;
+	int alignMask = 0;
 };
 
 template<int SIZE>
@@ -1070,6 +2127,174 @@ private:
 	CDynArray<T> arr;
 };
 
+/*	Where IndexedPQueue keeps the heap position of each key. DenseHeapIndex
+	is an array indexed by key: fastest, for keys that are small
+	non-negative ints, like node indices. HashHeapIndex is for sparse keys.
+*/
+class DenseHeapIndex
+{
+public:
+	int Get(int key) const { return key < pos.Size() ? pos[key] : -1; }
+	void Set(int key, int p) {
+		GLASSERT(key >= 0);
+		if (key >= pos.Size()) {
+			int n = pos.Size();
+			pos.PushArr(key + 1 - n);
+			for (int i = n; i <= key; ++i) pos[i] = -1;
+		}
+		pos[key] = p;
+	}
+	void Remove(int key) { pos[key] = -1; }
+
+private:
+	CDynArray<int> pos;
+};
+
+class HashHeapIndex
+{
+public:
+	int Get(int key) const {
+		int p = -1;
+		pos.TryGet(key, &p);
+		return p;
+	}
+	void Set(int key, int p) { pos.Add(key, p); }
+	void Remove(int key) { pos.Remove(key); }
+
+private:
+	IntHashTable<int, int> pos;
+};
+
+/*	A priority queue that knows where each item is in the heap, so
+	items can be updated or removed in O(log n) rather than found with
+	a linear walk. (Which is what PQueue::Set does.)
+	Requires a type with operator < and an int Key() that is unique
+	per item. ARITY is the number of children per node: 4 makes a
+	shallower heap with the children in one cache line, which is
+	usually faster than 2. Operates on blittable data.
+*/
+template<typename T, int ARITY = 4, class Index = DenseHeapIndex>
+class IndexedPQueue
+{
+	static_assert(ARITY >= 2, "heap needs at least 2 children");
+public:
+	// Pops the highest priority item.
+	T Pop() {
+		GLASSERT(!arr.Empty());
+		T v = arr[0];
+		index.Remove(v.Key());
+		T last = arr.Pop();
+		if (!arr.Empty()) {
+			arr[0] = last;
+			DownHeap(0);
+		}
+		return v;
+	}
+
+	const T& Top() const { return arr[0]; }
+
+	// Pushes a new item, or updates the priority of the item 
+	// with the same Key().
+	void Set(const T& t) {
+		int i = index.Get(t.Key());
+		if (i < 0) {
+			arr.Push(t);
+			UpHeap(arr.Size() - 1);
+		}
+		else if (t < arr[i]) {
+			arr[i] = t;
+			DownHeap(i);
+		}
+		else {
+			arr[i] = t;
+			UpHeap(i);
+		}
+	}
+
+	// Removes the item with 'key', if it is in the queue.
+	bool Remove(int key) {
+		int i = index.Get(key);
+		if (i < 0) return false;
+		index.Remove(key);
+		T last = arr.Pop();
+		if (i < arr.Size()) {
+			arr[i] = last;
+			if (i > 0 && arr[Parent(i)] < last)
+				UpHeap(i);
+			else
+				DownHeap(i);
+		}
+		return true;
+	}
+
+	bool Contains(int key) const { return index.Get(key) >= 0; }
+
+	// Returns the queued item with 'key', or null.
+	const T* Get(int key) const {
+		int i = index.Get(key);
+		return i >= 0 ? &arr[i] : 0;
+	}
+
+	int Size() const { return arr.Size(); }
+	bool Empty() const { return arr.Empty(); }
+
+	void Clear() {
+		for (int i = 0; i < arr.Size(); ++i)
+			index.Remove(arr[i].Key());
+		arr.Clear();
+	}
+
+	bool IsHeap() const {
+		for (int i = 0; i < arr.Size(); ++i) {
+			if (index.Get(arr[i].Key()) != i)
+				return false;
+			if (i > 0 && arr[Parent(i)] < arr[i])
+				return false;
+		}
+		return true;
+	}
+
+private:
+	void Place(int k, const T& v) {
+		arr[k] = v;
+		index.Set(v.Key(), k);
+	}
+
+	void UpHeap(int k) {
+		T v = arr[k];
+		while (k > 0 && arr[Parent(k)] < v) {
+			Place(k, arr[Parent(k)]);
+			k = Parent(k);
+		}
+		Place(k, v);
+	}
+
+	void DownHeap(int k) {
+		T v = arr[k];
+		const int size = arr.Size();
+		while (FirstChild(k) < size) {
+			int first = FirstChild(k);
+			int end = Min(first + ARITY, size);
+			int j = first;
+			for (int c = first + 1; c < end; ++c) {
+				if (arr[j] < arr[c])
+					j = c;
+			}
+			if (!(v < arr[j]))
+				break;
+			Place(k, arr[j]);
+			k = j;
+		}
+		Place(k, v);
+	}
+
+	int FirstChild(int i) const { return i * ARITY + 1; }
+	int Parent(int i) const { return (i - 1) / ARITY; }
+
+	CDynArray<T> arr;
+	Index index;
+};
+
 struct AStarNode
 {
 	int index;
@@ -1078,6 +2303,7 @@ struct AStarNode
 	bool operator<(const AStarNode& rhs) const { return cost > rhs.cost; }
 	bool operator>(const AStarNode& rhs) const { return cost < rhs.cost; }
 	bool KeyEqual(const AStarNode& rhs) const { return index == rhs.index; }
+	int Key() const { return index; }
 };
 
 }	// namespace grinliz
@@ -0,0 +1,415 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glflowfield.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#include <math.h>
+
+using namespace grinliz;
+
+const int FlowField::DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const int FlowField::DY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+static const float DIAGONAL = 1.41421356f;
+static const int CACHE_LINE = 64;
+
+static size_t RoundUp(size_t n) { return (n + CACHE_LINE - 1) & ~size_t(CACHE_LINE - 1); }
+
+FlowField::FlowField(int w, int h) : width(w), height(h)
+{
+	GLASSERT(w > 0 && h > 0);
+	stride = (w + 15) & ~15;
+	const size_t n = size_t(stride) * h;
+	const size_t distSize = RoundUp(n * sizeof(float));
+	const size_t costSize = RoundUp(n);
+	allocSize = distSize + costSize + RoundUp(n);
+	uint8_t* mem = (uint8_t*)DefaultAlloc::Alloc(allocSize, CACHE_LINE);
+	dist = (float*)mem;
+	cost = mem + distSize;
+	dir = (int8_t*)(mem + distSize + costSize);
+
+	// The padding at the end of each row is blocked.
+	for (int y = 0; y < h; ++y) {
+		memset(cost + y * stride, 1, w);
+		memset(cost + y * stride + w, 0, stride - w);
+	}
+	for (size_t i = 0; i < n; ++i) dist[i] = FLT_MAX;
+	memset(dir, NO_DIRECTION, n);
+}
+
+FlowField::~FlowField()
+{
+	DefaultAlloc::Free(dist, allocSize, CACHE_LINE);
+}
+
+void FlowField::SetGoals(const GridPoint* g, int n)
+{
+	goals.Clear();
+	for (int i = 0; i < n; ++i)
+		goals.Push(Index(g[i].x, g[i].y));
+}
+
+bool FlowField::CanStep(int x, int y, int d) const
+{
+	int nx = x + DX[d];
+	int ny = y + DY[d];
+	if (nx < 0 || ny < 0 || nx >= width || ny >= height || !cost[ny * stride + nx])
+		return false;
+	if (d & 1)
+		return cost[y * stride + nx] && cost[ny * stride + x];
+	return true;
+}
+
+// The cost of stepping into 'to', in direction 'd'.
+float FlowField::StepCost(int to, int d) const
+{
+	return (d & 1) ? float(cost[to]) * DIAGONAL : float(cost[to]);
+}
+
+void FlowField::Grow(int x, int y)
+{
+	bx0 = Min(bx0, x);
+	by0 = Min(by0, y);
+	bx1 = Max(bx1, x);
+	by1 = Max(by1, y);
+}
+
+void FlowField::Seed(int i, float d)
+{
+	dist[i] = d;
+	queue.Set({ i, d });
+}
+
+// Dijkstra, but the distances outside the queue are kept: that is what
+// lets Update() re-propagate from the edge of the changed area.
+void FlowField::Propagate()
+{
+	while (!queue.Empty()) {
+		const AStarNode node = queue.Pop();
+		const int u = node.index;
+		const int ux = u % stride;
+		const int uy = u / stride;
+		Grow(ux, uy);
+
+		// Relax the cells that can step into 'u': a neighbor in
+		// direction 'd' steps back in direction d^4.
+		for (int d = 0; d < 8; ++d) {
+			int vx = ux + DX[d];
+			int vy = uy + DY[d];
+			if (vx < 0 || vy < 0 || vx >= width || vy >= height)
+				continue;
+			int v = vy * stride + vx;
+			if (!cost[v] || !CanStep(vx, vy, d ^ 4))
+				continue;
+			float dv = node.cost + StepCost(u, d ^ 4);
+			if (dv < dist[v]) {
+				dist[v] = dv;
+				queue.Set({ v, dv });
+			}
+		}
+	}
+}
+
+void FlowField::ComputeDirections(int x0, int y0, int x1, int y1)
+{
+	x0 = Max(x0, 0);
+	y0 = Max(y0, 0);
+	x1 = Min(x1, width - 1);
+	y1 = Min(y1, height - 1);
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			const int i = y * stride + x;
+			int best = NO_DIRECTION;
+			if (dist[i] > 0 && dist[i] < FLT_MAX) {
+				float bestDist = FLT_MAX;
+				for (int d = 0; d < 8; ++d) {
+					if (!CanStep(x, y, d))
+						continue;
+					int n = i + DY[d] * stride + DX[d];
+					if (dist[n] == FLT_MAX)
+						continue;
+					float dn = dist[n] + StepCost(n, d);
+					if (dn < bestDist) {
+						bestDist = dn;
+						best = d;
+					}
+				}
+			}
+			dir[i] = int8_t(best);
+		}
+	}
+}
+
+void FlowField::Compute()
+{
+	for (int y = 0; y < height; ++y) {
+		float* row = dist + y * stride;
+		for (int x = 0; x < stride; ++x) row[x] = FLT_MAX;
+	}
+	bx0 = by0 = 0;
+	bx1 = by1 = -1;
+	for (int g : goals) {
+		if (cost[g]) Seed(g, 0);
+	}
+	Propagate();
+	ComputeDirections(0, 0, width - 1, height - 1);
+}
+
+void FlowField::Update(int x, int y, int w, int h)
+{
+	const int rx0 = Max(x, 0);
+	const int ry0 = Max(y, 0);
+	const int rx1 = Min(x + w, width) - 1;
+	const int ry1 = Min(y + h, height) - 1;
+	if (rx0 > rx1 || ry0 > ry1)
+		return;
+	bx0 = rx0; by0 = ry0;
+	bx1 = rx1; by1 = ry1;
+
+	// Invalidate the changed cells, and every cell whose flow runs 
+	// through them: those distances may have gone up.
+	stack.Clear();
+	for (int cy = ry0; cy <= ry1; ++cy) {
+		for (int cx = rx0; cx <= rx1; ++cx) {
+			const int i = cy * stride + cx;
+			dist[i] = FLT_MAX;
+			dir[i] = NO_DIRECTION;
+			stack.Push(i);
+		}
+	}
+	// A blocked cell also stops diagonal steps past its corners.
+	for (int cy = Max(ry0 - 1, 0); cy <= Min(ry1 + 1, height - 1); ++cy) {
+		for (int cx = Max(rx0 - 1, 0); cx <= Min(rx1 + 1, width - 1); ++cx) {
+			const int i = cy * stride + cx;
+			if (dir[i] != NO_DIRECTION && !CanStep(cx, cy, dir[i])) {
+				dist[i] = FLT_MAX;
+				dir[i] = NO_DIRECTION;
+				stack.Push(i);
+				Grow(cx, cy);
+			}
+		}
+	}
+	while (!stack.Empty()) {
+		const int u = stack.Pop();
+		const int ux = u % stride;
+		const int uy = u / stride;
+		for (int d = 0; d < 8; ++d) {
+			int vx = ux + DX[d];
+			int vy = uy + DY[d];
+			if (vx < 0 || vy < 0 || vx >= width || vy >= height)
+				continue;
+			int v = vy * stride + vx;
+			if (dir[v] == (d ^ 4)) {
+				dist[v] = FLT_MAX;
+				dir[v] = NO_DIRECTION;
+				stack.Push(v);
+				Grow(vx, vy);
+			}
+		}
+	}
+
+	// Re-seed from the valid cells around the invalidated area. (Valid
+	// cells inside it are fine to seed as well.) A goal that was
+	// invalidated restarts at 0.
+	for (int g : goals) {
+		int gx = g % stride, gy = g / stride;
+		if (gx >= bx0 && gx <= bx1 && gy >= by0 && gy <= by1 && cost[g])
+			Seed(g, 0);
+	}
+	const int sx0 = Max(bx0 - 1, 0), sy0 = Max(by0 - 1, 0);
+	const int sx1 = Min(bx1 + 1, width - 1), sy1 = Min(by1 + 1, height - 1);
+	for (int cy = sy0; cy <= sy1; ++cy) {
+		for (int cx = sx0; cx <= sx1; ++cx) {
+			const int i = cy * stride + cx;
+			if (cost[i] && dist[i] < FLT_MAX)
+				Seed(i, dist[i]);
+		}
+	}
+	Propagate();
+	// A direction depends on the neighbor distances.
+	ComputeDirections(bx0 - 1, by0 - 1, bx1 + 1, by1 + 1);
+}
+
+#ifdef DEBUG
+// Every direction steps to a neighbor that is exactly one step cost closer.
+static bool FlowValid(const FlowField& field)
+{
+	for (int y = 0; y < field.Height(); ++y) {
+		for (int x = 0; x < field.Width(); ++x) {
+			GridPoint n;
+			if (!field.Next(x, y, &n)) continue;
+			float step = float(field.Cost(n.x, n.y)) * ((n.x != x && n.y != y) ? DIAGONAL : 1.0f);
+			if (fabsf(field.Distance(n.x, n.y) + step - field.Distance(x, y)) > 0.001f * field.Distance(x, y))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool SameDistance(float a, float b)
+{
+	if (a == FLT_MAX || b == FLT_MAX) return a == b;
+	return fabsf(a - b) <= 0.001f * Max(1.0f, a);
+}
+#endif
+
+void grinliz::TestFlowField()
+{
+	Random random(41);
+	// Uniform costs: the distances are the A* path costs to the nearest goal.
+	{
+		static const int SIZE = 32;
+		BitArray<SIZE>* map = new BitArray<SIZE>();
+		FlowField field(SIZE, SIZE);
+		for (int y = 0; y < SIZE; ++y) {
+			for (int x = 0; x < SIZE; ++x) {
+				bool open = random.Rand(100) >= 20;
+				map->Set(x, y, open);
+				field.SetCost(x, y, open ? 1 : 0);
+			}
+		}
+		GridPoint goals[2] = { { 3, 4 }, { 28, 20 } };
+		for (const GridPoint& g : goals) {
+			map->Set(g.x, g.y);
+			field.SetCost(g.x, g.y, 1);
+		}
+		field.SetGoals(goals, 2);
+		field.Compute();
+		GLASSERT(FlowValid(field));
+		GLASSERT(field.Distance(3, 4) == 0 && field.Direction(3, 4) == FlowField::NO_DIRECTION);
+
+		GridPathfinder<SIZE> pf(map);
+		CDynArray<GridPoint> path;
+		for (int y = 0; y < SIZE; ++y) {
+			for (int x = 0; x < SIZE; ++x) {
+				float best = FLT_MAX;
+				for (const GridPoint& g : goals) {
+					float c = 0;
+					if (pf.FindPath({ x, y }, g, &path, &c))
+						best = Min(best, c);
+				}
+				GLASSERT(SameDistance(best, field.Distance(x, y)));
+			}
+		}
+		// Following the flow gets to a goal.
+		GridPoint p = { 0, 0 };
+		while (field.Distance(p.x, p.y) < FLT_MAX && field.Next(p.x, p.y, &p)) {}
+		GLASSERT(field.Distance(p.x, p.y) == FLT_MAX || field.Distance(p.x, p.y) == 0);
+		delete map;
+	}
+	// Update() matches a full Compute() after random changes.
+	{
+		static const int W = 45, H = 29;
+		FlowField field(W, H);
+		FlowField check(W, H);
+		GLASSERT(field.Stride() == 48);
+		GridPoint goals[3] = { { 1, 1 }, { 40, 25 }, { 20, 14 } };
+		field.SetGoals(goals, 3);
+		check.SetGoals(goals, 3);
+		field.Compute();
+
+		for (int step = 0; step < 200; ++step) {
+			int x = random.Rand(W), y = random.Rand(H);
+			int w = 1 + random.Rand(6), h = 1 + random.Rand(6);
+			int c = random.Rand(4) == 0 ? 0 : 1 + random.Rand(9);
+			for (int cy = y; cy < Min(y + h, H); ++cy)
+				for (int cx = x; cx < Min(x + w, W); ++cx)
+					field.SetCost(cx, cy, c);
+			field.Update(x, y, w, h);
+
+			for (int cy = 0; cy < H; ++cy)
+				for (int cx = 0; cx < W; ++cx)
+					check.SetCost(cx, cy, field.Cost(cx, cy));
+			check.Compute();
+			for (int cy = 0; cy < H; ++cy) {
+				for (int cx = 0; cx < W; ++cx) {
+					GLASSERT(SameDistance(field.Distance(cx, cy), check.Distance(cx, cy)));
+					GLASSERT((field.Direction(cx, cy) == FlowField::NO_DIRECTION) == (check.Direction(cx, cy) == FlowField::NO_DIRECTION));
+				}
+			}
+			GLASSERT(FlowValid(field));
+		}
+	}
+}
+
+void grinliz::BenchFlowField()
+{
+	static const int SIZE = 1024;
+	static const int N_AGENTS = 400;
+	static const int N_UPDATES = 100;
+	Random random(8);
+	FlowField field(SIZE, SIZE);
+	BitArray<SIZE>* map = new BitArray<SIZE>();
+
+	// Open ground with walls; every agent heads for one of 4 goals.
+	for (int y = 0; y < SIZE; ++y)
+		for (int x = 0; x < SIZE; ++x)
+			map->Set(x, y);
+	for (int w = 0; w < SIZE / 8; ++w) {
+		int x = random.Rand(SIZE - SIZE / 4), y = random.Rand(SIZE);
+		for (int i = 0; i < SIZE / 4; ++i)
+			if (i != SIZE / 8) map->Clear(x + i, y);
+	}
+	for (int y = 0; y < SIZE; ++y)
+		for (int x = 0; x < SIZE; ++x)
+			field.SetCost(x, y, map->IsSet(x, y));
+	GridPoint goals[4] = { { 100, 100 }, { 900, 120 }, { 500, 500 }, { 200, 850 } };
+	for (const GridPoint& g : goals) {
+		map->Set(g.x, g.y);
+		field.SetCost(g.x, g.y, 1);
+	}
+	field.SetGoals(goals, 4);
+
+	timePoint_t start = Now();
+	field.Compute();
+	double tCompute = DeltaSeconds(start, Now());
+
+	start = Now();
+	for (int i = 0; i < N_UPDATES; ++i) {
+		int x = random.Rand(SIZE - 8), y = random.Rand(SIZE - 8);
+		int c = random.Rand(2) ? 0 : 1;
+		for (int cy = y; cy < y + 8; ++cy)
+			for (int cx = x; cx < x + 8; ++cx)
+				field.SetCost(cx, cy, c);
+		field.Update(x, y, 8, 8);
+	}
+	double tUpdate = DeltaSeconds(start, Now());
+
+	// The same agents, each searching for its own path to its goal.
+	GridPathfinder<SIZE> pf(map);
+	CDynArray<GridPoint> path;
+	start = Now();
+	for (int i = 0; i < N_AGENTS; ++i) {
+		GridPoint a = { int(random.Rand(SIZE)), int(random.Rand(SIZE)) };
+		pf.FindPath(a, goals[i & 3], &path, 0, GridPathfinder<SIZE>::JUMP_POINT);
+	}
+	double tPaths = DeltaSeconds(start, Now());
+
+	printf("FlowField %dx%d, 4 goals: Compute=%.1f ms  Update(8x8)=%.2f ms  vs. %d jump point searches=%.1f ms\n",
+		SIZE, SIZE, tCompute * 1000.0, tUpdate * 1000.0 / N_UPDATES, N_AGENTS, tPaths * 1000.0);
+	delete map;
+}
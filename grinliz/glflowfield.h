@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_FLOWFIELD_INCLUDED
+#define GRINLIZ_FLOWFIELD_INCLUDED
+
+#include <stdint.h>
+#include <float.h>
+
+#include "glcontainer.h"
+#include "glpathfinder.h"
+
+namespace grinliz
+{
+
+void TestFlowField();
+void BenchFlowField();
+
+/*	A flow field (or "Dijkstra map"): the distance from every cell of
+	a grid to the nearest of a set of goals, and the direction to step
+	to get there. One Compute() serves any number of agents heading to
+	the same goals, instead of a path search for each.
+
+	Each cell has a cost to enter: 0 is blocked, 1-255 passable. Moves
+	are to the 8 neighbors (diagonals cost sqrt(2) times as much, and 
+	can't cut a blocked corner), the same as GridPathfinder.
+
+	When costs change, Update() re-propagates only the cells whose
+	distance depended on the changed area, rather than the whole grid.
+
+	Costs, distances, and directions are separate row-major arrays,
+	aligned to a cache line, with each row padded to a multiple of 16
+	cells (padding is blocked.) Rows can be read directly and processed
+	16 at a time.
+*/
+class FlowField
+{
+public:
+	enum { NO_DIRECTION = -1 };
+	// The 8 directions, counter-clockwise from +x. Odd are diagonal.
+	static const int DX[8];
+	static const int DY[8];
+
+	FlowField(int width, int height);
+	~FlowField();
+
+	FlowField(const FlowField&) = delete;
+	void operator=(const FlowField&) = delete;
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	// Elements per row of the row arrays.
+	int Stride() const { return stride; }
+
+	// Costs start at 1. Call Compute() or Update() to apply changes.
+	void SetCost(int x, int y, int c) {
+		GLASSERT(c >= 0 && c <= 255);
+		cost[Index(x, y)] = uint8_t(c);
+	}
+	int Cost(int x, int y) const { return cost[Index(x, y)]; }
+
+	// Replaces the goals. Call Compute() to apply.
+	void SetGoals(const GridPoint* goals, int n);
+
+	// Full Dijkstra from the goals.
+	void Compute();
+
+	// Re-propagates after the costs in the rectangle (x, y, w, h)
+	// changed. The goals must not have changed.
+	void Update(int x, int y, int w, int h);
+
+	// FLT_MAX if no goal can be reached.
+	float Distance(int x, int y) const { return dist[Index(x, y)]; }
+	// One of the 8 directions, or NO_DIRECTION at a goal or if no goal can be reached.
+	int Direction(int x, int y) const { return dir[Index(x, y)]; }
+
+	// The next cell towards a goal. Returns false at a goal, or if
+	// no goal can be reached.
+	bool Next(int x, int y, GridPoint* next) const {
+		int d = dir[Index(x, y)];
+		if (d == NO_DIRECTION) return false;
+		next->x = x + DX[d];
+		next->y = y + DY[d];
+		return true;
+	}
+
+	const uint8_t* CostRow(int y) const { return cost + y * stride; }
+	const float* DistanceRow(int y) const { return dist + y * stride; }
+	const int8_t* DirectionRow(int y) const { return dir + y * stride; }
+
+private:
+	int Index(int x, int y) const {
+		GLASSERT(x >= 0 && x < width && y >= 0 && y < height);
+		return y * stride + x;
+	}
+	// True if an agent at (x, y) can step in direction 'd'.
+	bool CanStep(int x, int y, int d) const;
+	float StepCost(int to, int d) const;
+	void Seed(int i, float d);
+	void Propagate();
+	void ComputeDirections(int x0, int y0, int x1, int y1);
+	void Grow(int x, int y);
+
+	int width, height, stride;
+	size_t allocSize = 0;
+	uint8_t* cost = 0;
+	float* dist = 0;
+	int8_t* dir = 0;
+
+	CDynArray<int> goals;
+	IndexedPQueue<AStarNode, 4> queue;
+	CDynArray<int> stack;
+	// Cells changed by the current propagation; inclusive.
+	int bx0 = 0, by0 = 0, bx1 = -1, by1 = -1;
+};
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_FLOWFIELD_INCLUDED
@@ -0,0 +1,233 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glhashimage.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace grinliz;
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	file = f;
+	LARGE_INTEGER s;
+	if (!GetFileSizeEx(f, &s) || s.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	HANDLE m = CreateFileMappingA(f, 0, PAGE_READONLY, 0, 0, 0);
+	if (!m) {
+		Close();
+		return false;
+	}
+	mapping = m;
+	data = (const uint8_t*)MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		Close();
+		return false;
+	}
+	size = size_t(s.QuadPart);
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* p = mmap(0, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	// the mapping keeps the file open
+	if (p == MAP_FAILED)
+		return false;
+	data = (const uint8_t*)p;
+	size = size_t(st.st_size);
+#endif
+	return true;
+}
+
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle((HANDLE)mapping);
+	if (file) CloseHandle((HANDLE)file);
+	mapping = 0;
+	file = 0;
+#else
+	if (data) munmap((void*)data, size);
+#endif
+	data = 0;
+	size = 0;
+}
+
+
+static bool WriteImageFile(HashTable<uint64_t, uint32_t, IntHash<uint64_t>>& table, const char* path)
+{
+	FILE* fp = fopen(path, "wb");
+	if (!fp) return false;
+	bool okay = WriteHashImage(table, fp);
+	fclose(fp);
+	return okay;
+}
+
+
+void grinliz::TestHashImage()
+{
+	static const char* PATH = "hashimage_test.bin";
+	static const int N = 10'000;
+
+	IntHashTable<uint64_t, uint32_t> table;
+	table.SetSeed(1234);
+	for (int i = 0; i < N; ++i)
+		table.Add(uint64_t(i) << 20, uint32_t(i));
+	for (int i = 0; i < N; i += 3)
+		table.Remove(uint64_t(i) << 20);
+	bool okay = WriteImageFile(table, PATH);
+	GLASSERT(okay);
+
+	{
+		HashTableView<uint64_t, uint32_t, IntHash<uint64_t>> view;
+		okay = view.Open(PATH);
+		GLASSERT(okay);
+		GLASSERT(view.Verify());
+		GLASSERT(view.Size() == table.Size());
+		GLASSERT(view.NumBuckets() == table.NumBuckets());
+		GLASSERT(view.Seed() == 1234);
+		for (int i = 0; i < N; ++i) {
+			uint32_t v = 0;
+			bool found = view.TryGet(uint64_t(i) << 20, &v);
+			GLASSERT(found == (i % 3 != 0));
+			GLASSERT(!found || v == uint32_t(i));
+			(void)found;
+		}
+		GLASSERT(!view.Contains(1));
+
+		// Different types don't match the header.
+		HashTableView<uint64_t, uint64_t, IntHash<uint64_t>> wrongValue;
+		okay = wrongValue.Open(PATH);
+		GLASSERT(!okay);
+	}
+	// Corrupt one byte of the data; the header still opens,
+	// but Verify() catches it.
+	if (FILE* fp = fopen(PATH, "r+b")) {
+		fseek(fp, long(sizeof(HashImageHeader) + 100), SEEK_SET);
+		fputc(0x55, fp);
+		fclose(fp);
+
+		HashTableView<uint64_t, uint32_t, IntHash<uint64_t>> view;
+		okay = view.Open(PATH);
+		GLASSERT(okay);
+		GLASSERT(!view.Verify());
+	}
+	else {
+		GLASSERT(false);
+	}
+	{
+		IntHashTable<uint64_t, uint32_t> empty;
+		okay = WriteImageFile(empty, PATH);
+		GLASSERT(okay);
+		HashTableView<uint64_t, uint32_t, IntHash<uint64_t>> view;
+		okay = view.Open(PATH);
+		GLASSERT(okay);
+		GLASSERT(view.Verify());
+		GLASSERT(view.Empty());
+		GLASSERT(!view.Contains(0));
+	}
+	(void)okay;
+	remove(PATH);
+}
+
+
+void grinliz::BenchHashImage()
+{
+	static const char* PATH = "hashimage_bench.bin";
+	static const int N = 50'000'000;
+	static const int N_QUERIES = 1'000'000;
+
+	Random random(31);
+	uint64_t* keys = new uint64_t[N];
+	for (int i = 0; i < N; ++i)
+		keys[i] = (uint64_t(random.Rand()) << 32) | random.Rand();
+
+	// What startup does today: one Add at a time.
+	{
+		IntHashTable<uint64_t, uint32_t> table;
+		timePoint_t start = Now();
+		for (int i = 0; i < N; ++i)
+			table.Add(keys[i], uint32_t(i));
+		double tBuild = DeltaSeconds(start, Now());
+
+		start = Now();
+		bool okay = WriteImageFile(table, PATH);
+		double tWrite = DeltaSeconds(start, Now());
+		GLASSERT(okay);
+		(void)okay;
+		printf("Hash image, %d entries (%d MB): build with Add=%.0f ms  write image=%.0f ms\n",
+			N, int(table.MemoryInUse() / (1024 * 1024)), tBuild * 1000.0, tWrite * 1000.0);
+	}
+	{
+		HashTableView<uint64_t, uint32_t, IntHash<uint64_t>> view;
+		timePoint_t start = Now();
+		bool okay = view.Open(PATH);
+		double tOpen = DeltaSeconds(start, Now());
+		GLASSERT(okay);
+
+		start = Now();
+		uint64_t check = 0;
+		for (int i = 0; i < N_QUERIES; ++i) {
+			uint32_t v = 0;
+			view.TryGet(keys[random.Rand(N)], &v);
+			check += v;
+		}
+		double tQuery = DeltaSeconds(start, Now());
+
+		start = Now();
+		okay = view.Verify();
+		double tVerify = DeltaSeconds(start, Now());
+		GLASSERT(okay);
+		(void)okay;
+		printf("  open=%.3f ms  first %d lookups=%.0f ms  verify=%.0f ms (check=%llu)\n",
+			tOpen * 1000.0, N_QUERIES, tQuery * 1000.0, tVerify * 1000.0, (unsigned long long)check);
+	}
+	remove(PATH);
+	delete[] keys;
+}
@@ -0,0 +1,231 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_HASH_IMAGE_INCLUDED
+#define GRINLIZ_HASH_IMAGE_INCLUDED
+
+#include <stdio.h>
+
+#include "glcontainer.h"
+#include "SpookyV2.h"
+
+namespace grinliz
+{
+
+void TestHashImage();
+void BenchHashImage();
+
+// A file mapped read-only into memory.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+
+	bool Open(const char* path);
+	void Close();
+
+	const uint8_t* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	MappedFile(const MappedFile&);
+	void operator=(const MappedFile&);
+
+	const uint8_t* data = 0;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = 0;
+	void* mapping = 0;
+#endif
+};
+
+/* A hash image is the buckets of a HashTable, stored as a file that
+   can be mapped and queried in place, with no loading step. It's the
+   header below, then the table's memory block as is: control bytes,
+   then buckets. Nothing in it is a pointer, so it can be mapped at
+   any address.
+
+   The image is only valid for the same key, value, and hash policy 
+   types it was written with, on a machine of the same endianness. 
+   The header checks what it can: the magic and version, the sizes,
+   and a checksum of the data.
+*/
+struct HashImageHeader
+{
+	static constexpr uint32_t MAGIC = 0x49534847;	// "GHSI"
+	static constexpr uint32_t VERSION = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t keySize;
+	uint32_t valueSize;
+	uint32_t bucketSize;
+	uint32_t nBuckets;
+	uint32_t nItems;
+	uint32_t pad;
+	uint64_t seed;			// HashTable::Seed() when written
+	uint64_t checksum;		// SpookyHash of the data after the header
+	uint64_t dataSize;		// bytes after the header
+	uint64_t reserved;
+};
+static_assert(sizeof(HashImageHeader) == 64, "the data after the header must stay aligned");
+
+// Writes the image of 'table' to 'fp'. (Finishes any migration
+// in progress, which is why 'table' isn't const.) The data is 
+// written straight from the table's memory.
+template<class K, class V, class H, class A>
+bool WriteHashImage(HashTable<K, V, H, A>& table, FILE* fp)
+{
+	using Table = HashBuckets<K, V, H, A>;
+	const Table& t = table.Buckets();
+	const size_t dataSize = t.AllocSize();
+
+	HashImageHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = HashImageHeader::MAGIC;
+	header.version = HashImageHeader::VERSION;
+	header.keySize = sizeof(K);
+	header.valueSize = sizeof(V);
+	header.bucketSize = sizeof(typename Table::Bucket);
+	header.nBuckets = uint32_t(t.nBuckets);
+	header.nItems = uint32_t(t.nItems);
+	header.seed = table.Seed();
+	header.checksum = dataSize ? SpookyHash::Hash64(t.mem, dataSize, 0) : 0;
+	header.dataSize = dataSize;
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+		return false;
+	if (dataSize && fwrite(t.mem, dataSize, 1, fp) != 1)
+		return false;
+	return true;
+}
+
+/* Read-only lookups on a hash image, from the mapped file. Open()
+   only reads the header, so its cost doesn't depend on the size of
+   the table; pages are loaded by the OS as lookups touch them.
+   Verify() checks the data against the checksum, which does read
+   all of it.
+*/
+template<class K, class V, class H = BlitHash<K>>
+class HashTableView
+{
+public:
+	HashTableView() {}
+	~HashTableView() { Close(); }
+
+	bool Open(const char* path) {
+		Close();
+		if (!file.Open(path))
+			return false;
+
+		HashImageHeader header;
+		if (file.Size() < sizeof(header)) {
+			Close();
+			return false;
+		}
+		memcpy(&header, file.Data(), sizeof(header));
+		if (header.magic != HashImageHeader::MAGIC
+			|| header.version != HashImageHeader::VERSION
+			|| header.keySize != sizeof(K)
+			|| header.valueSize != sizeof(V)
+			|| header.bucketSize != sizeof(Bucket)
+			|| (header.nBuckets && (!IsPowerOf2(header.nBuckets) || header.nBuckets < uint32_t(Table::MIN_BUCKETS)))
+			|| header.dataSize != Table::AllocSize(int(header.nBuckets))
+			|| file.Size() != sizeof(header) + header.dataSize)
+		{
+			Close();
+			return false;
+		}
+
+		// The table points into the mapping, and never frees it.
+		uint8_t* data = const_cast<uint8_t*>(file.Data()) + sizeof(header);
+		table.nBuckets = int(header.nBuckets);
+		table.mask = header.nBuckets ? header.nBuckets - 1 : 0;
+		table.nItems = int(header.nItems);
+		table.seed = header.seed;
+		if (table.nBuckets) {
+			table.ctrl = (int8_t*)data;
+			table.buckets = (Bucket*)(data + Table::BucketOffset(table.nBuckets));
+		}
+		checksum = header.checksum;
+		return true;
+	}
+
+	void Close() {
+		table = Table();
+		file.Close();
+	}
+
+	bool IsOpen() const { return file.Data() != 0; }
+
+	// Reads the entire image.
+	bool Verify() const {
+		if (!IsOpen())
+			return false;
+		const size_t dataSize = file.Size() - sizeof(HashImageHeader);
+		uint64_t c = dataSize ? SpookyHash::Hash64(file.Data() + sizeof(HashImageHeader), dataSize, 0) : 0;
+		return c == checksum;
+	}
+
+	bool TryGet(const K& key, V* value) const {
+		int index = table.Find(key, table.Hash(key));
+		if (index >= 0) {
+			if (value) *value = table.buckets[index].value;
+			return true;
+		}
+		return false;
+	}
+
+	V Get(const K& key) const {
+		V v = V();
+		bool found = TryGet(key, &v);
+		GLASSERT(found);
+		(void)found;
+		return v;
+	}
+
+	bool Contains(const K& key) const { return TryGet(key, 0); }
+
+	bool Empty() const { return table.nItems == 0; }
+	int Size() const { return table.nItems; }
+	int NumBuckets() const { return table.nBuckets; }
+	uint64_t Seed() const { return table.seed; }
+
+private:
+	HashTableView(const HashTableView&);
+	void operator=(const HashTableView&);
+
+	using Table = HashBuckets<K, V, H>;
+	using Bucket = typename Table::Bucket;
+
+	MappedFile file;
+	Table table;
+	uint64_t checksum = 0;
+};
+
+} // namespace grinliz
+
+#endif // GRINLIZ_HASH_IMAGE_INCLUDED
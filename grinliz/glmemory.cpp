@@ -0,0 +1,442 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glmemory.h"
+#include "glcontainer.h"
+#include "glparser.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace grinliz;
+
+static void* SystemAlloc(size_t align, size_t size, void*)
+{
+	if (align <= MALLOC_ALIGN)
+		return malloc(size);
+#ifdef _WIN32
+	return _aligned_malloc(size, align);
+#else
+	void* p = 0;
+	if (posix_memalign(&p, align, size) != 0)
+		return 0;
+	return p;
+#endif
+}
+
+static void SystemFree(void* p, size_t align, size_t, void*)
+{
+#ifdef _WIN32
+	if (align > MALLOC_ALIGN) {
+		_aligned_free(p);
+		return;
+	}
+#else
+	(void)align;
+#endif
+	free(p);
+}
+
+static void* SystemRealloc(void* p, size_t align, size_t oldSize, size_t newSize, void*)
+{
+	if (align <= MALLOC_ALIGN)
+		return realloc(p, newSize);
+#ifdef _WIN32
+	(void)oldSize;
+	return _aligned_realloc(p, newSize, align);
+#else
+	// There's no aligned realloc; copy.
+	void* q = SystemAlloc(align, newSize, 0);
+	if (!q)
+		return 0;	// like realloc, 'p' is still valid
+	if (p) {
+		memcpy(q, p, Min(oldSize, newSize));
+		free(p);
+	}
+	return q;
+#endif
+}
+
+static CustomAllocator gAllocator = { SystemAlloc, SystemRealloc, SystemFree, 0 };
+
+CustomAllocator grinliz::SystemAllocator()
+{
+	return { SystemAlloc, SystemRealloc, SystemFree, 0 };
+}
+
+void grinliz::SetCustomAllocator(const CustomAllocator& allocator)
+{
+	GLASSERT(allocator.alloc && allocator.realloc && allocator.free);
+	gAllocator = allocator;
+}
+
+const CustomAllocator& grinliz::GetCustomAllocator()
+{
+	return gAllocator;
+}
+
+void* DefaultAlloc::Alloc(size_t size, size_t align)
+{
+	return gAllocator.alloc(align, size, gAllocator.userData);
+}
+
+void* DefaultAlloc::Calloc(size_t size, size_t align)
+{
+	// The system calloc can skip the clear for fresh pages.
+	if (gAllocator.alloc == SystemAlloc && align <= MALLOC_ALIGN)
+		return calloc(size, 1);
+	void* p = gAllocator.alloc(align, size, gAllocator.userData);
+	memset(p, 0, size);
+	return p;
+}
+
+void* DefaultAlloc::Realloc(void* p, size_t oldSize, size_t newSize, size_t align)
+{
+	return gAllocator.realloc(p, align, oldSize, newSize, gAllocator.userData);
+}
+
+void DefaultAlloc::Free(void* p, size_t size, size_t align)
+{
+	if (p)
+		gAllocator.free(p, align, size, gAllocator.userData);
+}
+
+Arena::~Arena()
+{
+	while (first) {
+		Block* next = first->next;
+		DefaultAlloc::Free(first, sizeof(Block) + first->size, 16);
+		first = next;
+	}
+}
+
+void* Arena::AllocSlow(size_t size, size_t align)
+{
+	// Move on to the next block, if it's big enough, or chain a new
+	// one in after the current block.
+	Block* next = current ? current->next : 0;
+	if (!next || next->size < size + align) {
+		size_t dataSize = Max(blockSize, size + align);
+		Block* b = (Block*)DefaultAlloc::Alloc(sizeof(Block) + dataSize, 16);
+		b->next = next;
+		b->size = dataSize;
+		if (current)
+			current->next = b;
+		else
+			first = b;
+		next = b;
+	}
+	next->used = 0;
+	current = next;
+	return Alloc(size, align);
+}
+
+void* Arena::Realloc(void* p, size_t oldSize, size_t newSize, size_t align)
+{
+	if (p && current) {
+		uint8_t* data = current->Data();
+		size_t offset = (uint8_t*)p - data;
+		if ((uint8_t*)p >= data && offset + oldSize == current->used && offset + newSize <= current->size) {
+			current->used = offset + newSize;
+			return p;
+		}
+	}
+	void* q = Alloc(newSize, align);
+	if (p)
+		memcpy(q, p, Min(oldSize, newSize));
+	return q;
+}
+
+void Arena::Rewind(const Marker& marker)
+{
+	if (!marker.block) {
+		Reset();
+		return;
+	}
+	current = marker.block;
+	current->used = marker.used;
+}
+
+void Arena::Reset()
+{
+	current = first;
+	if (current)
+		current->used = 0;
+}
+
+size_t Arena::BytesUsed() const
+{
+	size_t total = 0;
+	for (Block* b = first; b && current; b = b->next) {
+		total += b->used;
+		if (b == current) break;
+	}
+	return total;
+}
+
+size_t Arena::MemoryInUse() const
+{
+	size_t total = 0;
+	for (Block* b = first; b; b = b->next)
+		total += sizeof(Block) + b->size;
+	return total;
+}
+
+int Arena::NumBlocks() const
+{
+	int n = 0;
+	for (Block* b = first; b; b = b->next)
+		++n;
+	return n;
+}
+
+void grinliz::TestArena()
+{
+	{
+		Arena arena(1024);
+		GLASSERT(arena.NumBlocks() == 0 && arena.BytesUsed() == 0);
+		void* a = arena.Alloc(10);
+		void* b = arena.Alloc(10, 64);
+		GLASSERT(((uintptr_t)a & 15) == 0 && ((uintptr_t)b & 63) == 0);
+		memset(a, 1, 10);
+		memset(b, 2, 10);
+
+		Arena::Marker mark = arena.Mark();
+		size_t used = arena.BytesUsed();
+		for (int i = 0; i < 100; ++i)
+			memset(arena.Alloc(100), 3, 100);
+		GLASSERT(arena.NumBlocks() > 1);
+		void* big = arena.Alloc(5000);		// bigger than a block
+		memset(big, 4, 5000);
+		arena.Rewind(mark);
+		GLASSERT(arena.BytesUsed() == used);
+		GLASSERT(((uint8_t*)a)[9] == 1 && ((uint8_t*)b)[9] == 2);
+		(void)used;
+
+		// The blocks are reused after a rewind.
+		int nBlocks = arena.NumBlocks();
+		size_t memory = arena.MemoryInUse();
+		for (int i = 0; i < 100; ++i)
+			arena.Alloc(100);
+		GLASSERT(arena.NumBlocks() == nBlocks && arena.MemoryInUse() == memory);
+		(void)memory;
+
+		// Realloc grows the last allocation in place.
+		void* r = arena.Alloc(16);
+		memset(r, 5, 16);
+		void* grown = arena.Realloc(r, 16, 64);
+		GLASSERT(grown == r);
+		memset(grown, 5, 64);
+		void* s = arena.Alloc(8);
+		void* r2 = arena.Realloc(grown, 64, 128);
+		GLASSERT(r2 != grown && r2 != s && ((uint8_t*)r2)[63] == 5);
+		(void)s;
+		(void)r2;
+
+		arena.Reset();
+		GLASSERT(arena.BytesUsed() == 0 && arena.NumBlocks() == nBlocks);
+		(void)nBlocks;
+	}
+	{
+		// Containers drawing from an arena.
+		Arena arena(4096);
+		CDynArray<int> arr;
+		arr.SetArena(&arena);
+		for (int i = 0; i < 1000; ++i)
+			arr.Push(i);
+		GLASSERT(arena.BytesUsed() >= 1000 * sizeof(int));
+		for (int i = 0; i < 1000; ++i)
+			GLASSERT(arr[i] == i);
+
+		CDynArray<int> moved = std::move(arr);
+		GLASSERT(moved.Size() == 1000 && moved[999] == 999 && moved.GetArena() == &arena);
+		CDynArray<int> copied = moved;
+		GLASSERT(copied.Size() == 1000 && copied.GetArena() == 0);
+		moved.FreeMem();
+
+		DynMemBuf buf;
+		buf.SetArena(&arena);
+		for (int i = 0; i < 1000; ++i)
+			buf.Add(i);
+		for (int i = 0; i < 1000; ++i) {
+			int v = 0;
+			buf.Get(&v);
+			GLASSERT(v == i);
+		}
+
+		CSVParser parser(',', &arena);
+		parser.Parse("a,b,c,d,e,f\ng,h,i,j,k,l\n");
+		GLASSERT(parser.Rows().size() == 2 && parser.Rows()[1][5] == "l");
+		GLASSERT(parser.Rows()[0].GetArena() == &arena);
+		arena.Reset();
+	}
+}
+
+namespace {
+	struct TrackedMemory {
+		int64_t bytes = 0;
+		int nAllocs = 0;
+		int maxAlign = 0;
+	};
+
+	void* TrackedAlloc(size_t align, size_t size, void* userData) {
+		TrackedMemory* t = (TrackedMemory*)userData;
+		t->bytes += size;
+		t->nAllocs++;
+		t->maxAlign = Max(t->maxAlign, int(align));
+		return SystemAllocator().alloc(align, size, 0);
+	}
+
+	void* TrackedRealloc(void* p, size_t align, size_t oldSize, size_t newSize, void* userData) {
+		TrackedMemory* t = (TrackedMemory*)userData;
+		t->bytes += int64_t(newSize) - int64_t(p ? oldSize : 0);
+		if (!p) t->nAllocs++;
+		return SystemAllocator().realloc(p, align, oldSize, newSize, 0);
+	}
+
+	void TrackedFree(void* p, size_t align, size_t size, void* userData) {
+		TrackedMemory* t = (TrackedMemory*)userData;
+		t->bytes -= size;
+		t->nAllocs--;
+		SystemAllocator().free(p, align, size, 0);
+	}
+}
+
+void grinliz::TestAllocator()
+{
+	{
+		TrackedMemory tracked;
+		SetCustomAllocator({ TrackedAlloc, TrackedRealloc, TrackedFree, &tracked });
+		{
+			CDynArray<int> arr;
+			for (int i = 0; i < 1000; ++i)
+				arr.Push(i);
+			GLASSERT(tracked.nAllocs == 1 && tracked.bytes == int64_t(arr.Capacity() * sizeof(int)));
+
+			DynArray<std::string> strings;
+			for (int i = 0; i < 100; ++i)
+				strings.Emplace("a string long enough to allocate on the heap");
+			IntHashTable<int, int> table;
+			for (int i = 0; i < 1000; ++i)
+				table.Add(i, i);
+			DynMemBuf buf;
+			for (int i = 0; i < 1000; ++i)
+				buf.Add(i);
+			GLASSERT(tracked.nAllocs == 4);
+			GLASSERT(tracked.bytes >= int64_t(table.MemoryInUse() + buf.Capacity()));
+		}
+		GLASSERT(tracked.nAllocs == 0 && tracked.bytes == 0);
+		{
+			Arena arena(1024);
+			arena.Alloc(100);
+			arena.Alloc(2000);
+			GLASSERT(tracked.nAllocs == 2);
+		}
+		GLASSERT(tracked.nAllocs == 0 && tracked.bytes == 0);
+		SetCustomAllocator(SystemAllocator());
+	}
+	{
+		// Over aligned memory, through growth.
+		// The inline cache is aligned too, so this holds at every size.
+		CDynArray<float, AlignedAlloc<64>> arr;
+		DynArray<double, AlignedAlloc<128>> arr2;
+		CDynArray<float, AlignedAlloc<64>>* heapArr = new CDynArray<float, AlignedAlloc<64>>();
+		Arena arena;
+		CDynArray<float, AlignedAlloc<64>> arenaArr;
+		arenaArr.SetArena(&arena);
+		arena.Alloc(4);
+		GLASSERT(((uintptr_t)arr.Mem() & 63) == 0 && ((uintptr_t)heapArr->Mem() & 63) == 0);
+		for (int i = 0; i < 1000; ++i) {
+			arr.Push(float(i));
+			arr2.Push(double(i));
+			heapArr->Push(float(i));
+			arenaArr.Push(float(i));
+			GLASSERT(((uintptr_t)arr.Mem() & 63) == 0);
+			GLASSERT(((uintptr_t)arr2.Mem() & 127) == 0);
+			GLASSERT(((uintptr_t)heapArr->Mem() & 63) == 0);
+			GLASSERT(((uintptr_t)arenaArr.Mem() & 63) == 0);
+		}
+		delete heapArr;
+		for (int i = 0; i < 1000; ++i)
+			GLASSERT(arr[i] == float(i) && arr2[i] == double(i));
+
+		IntHashTable<int, int, AlignedAlloc<64>> table;
+		for (int i = 0; i < 1000; ++i)
+			table.Add(i, i * 2);
+		for (int i = 0; i < 1000; ++i)
+			GLASSERT(table.Get(i) == i * 2);
+		GLASSERT(((uintptr_t)table.Buckets().mem & 63) == 0);
+	}
+}
+
+void grinliz::BenchArena()
+{
+	// A frame's worth of scratch arrays, of random sizes.
+	static const int FRAMES = 200;
+	static const int ARRAYS = 2000;
+	Random random(19);
+	int sizes[ARRAYS];
+	for (int i = 0; i < ARRAYS; ++i)
+		sizes[i] = 1 + random.Rand(200);
+	CDynArray<int>* arrays = new CDynArray<int>[ARRAYS];
+	int64_t check = 0;
+
+	timePoint_t start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		for (int i = 0; i < ARRAYS; ++i) {
+			for (int k = 0; k < sizes[i]; ++k)
+				arrays[i].Push(k);
+			check += arrays[i].Size();
+		}
+		for (int i = 0; i < ARRAYS; ++i)
+			arrays[i].FreeMem();
+	}
+	double tMalloc = DeltaSeconds(start, Now());
+
+	Arena arena;
+	start = Now();
+	for (int f = 0; f < FRAMES; ++f) {
+		for (int i = 0; i < ARRAYS; ++i) {
+			arrays[i].SetArena(&arena);
+			for (int k = 0; k < sizes[i]; ++k)
+				arrays[i].Push(k);
+			check += arrays[i].Size();
+		}
+		for (int i = 0; i < ARRAYS; ++i)
+			arrays[i].FreeMem();
+		arena.Reset();
+	}
+	double tArena = DeltaSeconds(start, Now());
+	delete[] arrays;
+
+	printf("Frame of %d scratch arrays (ms): malloc=%.3f Arena=%.3f memory=%dk (check=%d)\n",
+		ARRAYS, tMalloc * 1000.0 / FRAMES, tArena * 1000.0 / FRAMES, int(arena.MemoryInUse() / 1024), int(check));
+}
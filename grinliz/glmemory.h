@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_MEMORY_INCLUDED
+#define GRINLIZ_MEMORY_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "gldebug.h"
+
+namespace grinliz
+{
+
+void TestArena();
+void BenchArena();
+void TestAllocator();
+
+// What malloc guarantees, on the platforms we run on.
+static constexpr size_t MALLOC_ALIGN = 2 * sizeof(void*);
+
+/*	The allocator behind the containers (CDynArray, DynArray, HashTable,
+	DynMemBuf, StringPool, Arena and the pools), as function pointers
+	and user data, like enkiTS's CustomAllocator. It can be pointed at
+	a tracking allocator, huge pages, and so on. 'align' is a power of
+	2; sizes are always passed back to realloc and free. The default is
+	the system: malloc, or posix_memalign / _aligned_malloc for more 
+	than MALLOC_ALIGN.
+*/
+struct CustomAllocator
+{
+	typedef void* (*AllocFunc)(size_t align, size_t size, void* userData);
+	typedef void* (*ReallocFunc)(void* p, size_t align, size_t oldSize, size_t newSize, void* userData);
+	typedef void (*FreeFunc)(void* p, size_t align, size_t size, void* userData);
+
+	AllocFunc alloc;
+	ReallocFunc realloc;
+	FreeFunc free;
+	void* userData;
+};
+
+CustomAllocator SystemAllocator();
+// Must be set before anything is allocated, since memory has to be
+// freed by the allocator it came from.
+void SetCustomAllocator(const CustomAllocator& allocator);
+const CustomAllocator& GetCustomAllocator();
+
+/*	Allocator policies, the last template parameter of the containers.
+	DefaultAlloc goes to the CustomAllocator above. 
+	
+	AlignedAlloc raises the alignment of every allocation, for instance
+	CDynArray<float, AlignedAlloc<64>> for SIMD kernels. A policy is 
+	a struct of static functions with the same signatures, and an ALIGN
+	that containers also apply to memory they hold inline (like the 
+	cache of a CDynArray), so the alignment holds at every size.
+*/
+struct DefaultAlloc
+{
+	static constexpr size_t ALIGN = 1;
+
+	static void* Alloc(size_t size, size_t align);
+	// Zeroed memory; calloc() for the system allocator.
+	static void* Calloc(size_t size, size_t align);
+	static void* Realloc(void* p, size_t oldSize, size_t newSize, size_t align);
+	static void Free(void* p, size_t size, size_t align);
+};
+
+template<size_t A, class Base = DefaultAlloc>
+struct AlignedAlloc
+{
+	static_assert(A && (A & (A - 1)) == 0, "the alignment must be a power of 2");
+	static constexpr size_t ALIGN = A > Base::ALIGN ? A : Base::ALIGN;
+
+	static size_t Align(size_t align) { return align > ALIGN ? align : ALIGN; }
+
+	static void* Alloc(size_t size, size_t align) { return Base::Alloc(size, Align(align)); }
+	static void* Calloc(size_t size, size_t align) { return Base::Calloc(size, Align(align)); }
+	static void* Realloc(void* p, size_t oldSize, size_t newSize, size_t align) { return Base::Realloc(p, oldSize, newSize, Align(align)); }
+	static void Free(void* p, size_t size, size_t align) { Base::Free(p, size, Align(align)); }
+};
+
+/*	A linear (bump pointer) allocator for scratch memory, like the 
+	temporaries of a frame. Alloc just moves a pointer, and nothing is
+	freed on its own: Rewind() frees everything since a Mark(), and
+	Reset() frees everything, in O(1). When a block fills up, the next
+	one is chained on. Blocks are kept, and reused, until the Arena is
+	destroyed.
+
+	CDynArray, DynMemBuf and CSVParser can draw from an Arena (see 
+	their SetArena) so a frame's temporaries cost no malloc or free.
+	Not thread safe.
+*/
+class Arena
+{
+	struct Block;
+public:
+	Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+	~Arena();
+
+	void* Alloc(size_t size, size_t align = 16) {
+		GLASSERT(align && (align & (align - 1)) == 0);
+		if (current) {
+			const uintptr_t base = (uintptr_t)current->Data();
+			const size_t start = size_t(((base + current->used + align - 1) & ~uintptr_t(align - 1)) - base);
+			if (start + size <= current->size) {
+				current->used = start + size;
+				return current->Data() + start;
+			}
+		}
+		return AllocSlow(size, align);
+	}
+
+	// Resizes an allocation. If 'p' is the last one, it grows (or
+	// shrinks) in place when it can; otherwise this is a new Alloc and
+	// a copy. p may be null.
+	void* Realloc(void* p, size_t oldSize, size_t newSize, size_t align = 16);
+
+	struct Marker {
+		Block* block;
+		size_t used;
+	};
+	Marker Mark() const { return { current, current ? current->used : 0 }; }
+	// Frees everything allocated since 'marker'.
+	void Rewind(const Marker& marker);
+	// Frees everything.
+	void Reset();
+
+	// Bytes handed out (including alignment padding.)
+	size_t BytesUsed() const;
+	// Memory taken from the system.
+	size_t MemoryInUse() const;
+	int NumBlocks() const;
+
+private:
+	Arena(const Arena&);
+	void operator=(const Arena&);
+
+	struct Block {
+		Block* next;
+		size_t size;		// of the data
+		size_t used;
+		size_t pad;			// data is 16 byte aligned
+		uint8_t* Data() { return (uint8_t*)(this + 1); }
+	};
+	void* AllocSlow(size_t size, size_t align);
+
+	size_t blockSize;
+	Block* first = 0;
+	Block* current = 0;		// blocks after this are empty, and reused
+};
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_MEMORY_INCLUDED
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glparallelsort.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+using namespace grinliz;
+
+namespace {
+	struct Item {
+		float key;
+		int payload;
+	};
+}
+
+void grinliz::TestParallelSort()
+{
+	Random random(23);
+	// 3 threads makes an odd run out at the first merge.
+	for (int nThreads = 3; nThreads <= 4; ++nThreads) {
+		enki::TaskScheduler ts;
+		ts.Initialize(nThreads);
+
+		static const int SIZES[] = { 1000, 100'000, 1'000'003 };
+		for (int n : SIZES) {
+			std::vector<uint32_t> a(n), check;
+			for (int i = 0; i < n; ++i)
+				a[i] = random.Rand(n / 4);		// plenty of duplicates
+			check = a;
+			std::sort(check.begin(), check.end());
+
+			std::vector<uint32_t> b = a;
+			ParallelSort(ts, a.data(), n);
+			GLASSERT(a == check);
+			ParallelSort(ts, b.data(), n, [](uint32_t x, uint32_t y) { return x < y; });
+			GLASSERT(b == check);
+		}
+
+		static const int N = 300'000;
+		std::vector<Item> items(N);
+		for (int i = 0; i < N; ++i)
+			items[i] = { random.Uniform() * 100.0f - 50.0f, i };
+		ParallelSort(ts, items.data(), N, [](const Item& item) { return item.key; });
+		int64_t sum = items[0].payload;
+		for (int i = 1; i < N; ++i) {
+			GLASSERT(items[i - 1].key <= items[i].key);
+			sum += items[i].payload;
+		}
+		GLASSERT(sum == int64_t(N) * (N - 1) / 2);
+
+		// Signed zeros: the merge keeps the same order as Sort().
+		std::vector<float> f(N), fCheck;
+		for (int i = 0; i < N; ++i)
+			f[i] = (i & 1) ? -0.0f : float(random.Rand(3)) - 1.0f;
+		fCheck = f;
+		Sort(fCheck.data(), N);
+		ParallelSort(ts, f.data(), N);
+		GLASSERT(memcmp(f.data(), fCheck.data(), sizeof(float) * N) == 0);
+
+		ts.WaitforAllAndShutdown();
+	}
+}
+
+
+void grinliz::BenchParallelSort()
+{
+	static const int N = 10'000'000;
+	Random random(29);
+	std::vector<uint32_t> src(N), a(N);
+	std::vector<Item> srcItems(N), items(N);
+	for (int i = 0; i < N; ++i) {
+		src[i] = random.Rand();
+		srcItems[i] = { random.Uniform(), i };
+	}
+	auto itemLess = [](const Item& x, const Item& y) { return x.key < y.key; };
+
+	const int maxThreads = int(enki::GetNumHardwareThreads());
+	printf("ParallelSort %d elements (ms)\n", N);
+	for (int n = 1; n < maxThreads * 2; n *= 2) {
+		const int nThreads = Min(n, maxThreads);
+		enki::TaskScheduler ts;
+		ts.Initialize(nThreads);
+
+		a = src;
+		timePoint_t start = Now();
+		ParallelSort(ts, a.data(), N);
+		double tRadix = DeltaSeconds(start, Now());
+
+		items = srcItems;
+		start = Now();
+		ParallelSort(ts, items.data(), N, itemLess);
+		double tLess = DeltaSeconds(start, Now());
+
+		printf("  threads=%2d  uint32_t=%6.1f  Item by less=%6.1f\n", nThreads, tRadix * 1000.0, tLess * 1000.0);
+		ts.WaitforAllAndShutdown();
+		if (nThreads == maxThreads)
+			break;
+	}
+}
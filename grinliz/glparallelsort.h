@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_PARALLEL_SORT_INCLUDED
+#define GRINLIZ_PARALLEL_SORT_INCLUDED
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "glsort.h"
+#include "enkiTS/TaskScheduler.h"
+
+namespace grinliz
+{
+
+void TestParallelSort();
+void BenchParallelSort();
+
+/*
+	::ParallelSort(ts, T* mem, int size);
+	::ParallelSort(ts, T* mem, int size, LessFunc func);
+	::ParallelSort(ts, T* mem, int size, KeyFunc func);
+
+	Sort(), on the worker threads of 'ts' and the calling thread.
+
+	The array is cut into one run per thread, and the runs are sorted
+	in parallel with Sort() - so numbers and key functions still get
+	the radix sort. Then runs are merged pairwise, level by level. Each
+	merge is split into pieces of the output by binary search (the 
+	"merge path"), so the last merges, which are also the biggest, 
+	still use every thread.
+
+	Below PARALLEL_SORT_MIN elements, or with one thread, this is just
+	Sort(). Otherwise it needs a temporary array of 'size' T, so T must
+	be default constructible. Call it from outside any task.
+*/
+namespace sortimpl
+{
+	static constexpr int PARALLEL_SORT_MIN = 1 << 16;
+	// About the number of elements a merge task writes.
+	static constexpr int PARALLEL_MERGE_GRAIN = 1 << 15;
+
+	// The number of elements from 'a' in the first 'k' elements of
+	// the merge of 'a' and 'b'. Ties take 'a' first, like std::merge.
+	template<class T, class Less>
+	int CoRank(int k, const T* a, int m, const T* b, int n, Less& less) {
+		int lo = Max(0, k - n);
+		int hi = Min(k, m);
+		while (lo < hi) {
+			int i = lo + (hi - lo) / 2;
+			int j = k - i;
+			// a[i] is no greater than b[j-1], so it comes first: 
+			// more of 'a' is needed.
+			if (!less(b[j - 1], a[i]))
+				lo = i + 1;
+			else
+				hi = i;
+		}
+		return lo;
+	}
+
+	// A slice of one merge: output positions [k0, k1) of merging
+	// src[aStart, aStart + m) with src[aStart + m, aStart + m + n).
+	struct MergePiece {
+		int aStart, m, n;
+		int k0, k1;
+	};
+
+	template <class T, class SortRun, class Less>
+	void ParallelSort(enki::TaskScheduler& ts, T* mem, int size, SortRun& sortRun, Less& less)
+	{
+		const int nThreads = int(ts.GetNumTaskThreads());
+		if (size < PARALLEL_SORT_MIN || nThreads < 2) {
+			sortRun(mem, size);
+			return;
+		}
+
+		// Sort the runs.
+		const int nRuns = Min(nThreads, size / (PARALLEL_SORT_MIN / 2));
+		auto runStart = [size, nRuns](int r) { return int(int64_t(size) * r / nRuns); };
+		{
+			enki::TaskSet task(uint32_t(nRuns), [&](enki::TaskSetPartition range, uint32_t) {
+				for (uint32_t r = range.start; r < range.end; ++r) {
+					int start = runStart(r);
+					sortRun(mem + start, runStart(r + 1) - start);
+				}
+			});
+			ts.AddTaskSetToPipe(&task);
+			ts.WaitforTask(&task);
+		}
+
+		// Merge pairs of runs until there is one.
+		T* tmp = (T*)DefaultAlloc::Alloc(sizeof(T) * size, alignof(T));
+		std::uninitialized_default_construct(tmp, tmp + size);
+		T* src = mem;
+		T* dst = tmp;
+		std::vector<int> runs, next;
+		for (int r = 0; r <= nRuns; ++r)
+			runs.push_back(runStart(r));
+
+		std::vector<MergePiece> pieces;
+		while (runs.size() > 2) {
+			pieces.clear();
+			next.clear();
+			for (size_t r = 0; r + 1 < runs.size(); r += 2) {
+				const int aStart = runs[r];
+				const int m = runs[r + 1] - aStart;
+				// An odd run out has nothing to merge with (n == 0); it's moved.
+				const int n = (r + 2 < runs.size()) ? runs[r + 2] - runs[r + 1] : 0;
+				const int nPieces = Max(1, (m + n) / PARALLEL_MERGE_GRAIN);
+				for (int p = 0; p < nPieces; ++p) {
+					MergePiece piece = { aStart, m, n,
+						int(int64_t(m + n) * p / nPieces),
+						int(int64_t(m + n) * (p + 1) / nPieces) };
+					pieces.push_back(piece);
+				}
+				next.push_back(aStart);
+			}
+			next.push_back(size);
+
+			enki::TaskSet task(uint32_t(pieces.size()), [&](enki::TaskSetPartition range, uint32_t) {
+				for (uint32_t p = range.start; p < range.end; ++p) {
+					const MergePiece& piece = pieces[p];
+					T* a = src + piece.aStart;
+					T* b = a + piece.m;
+					const int i0 = CoRank(piece.k0, a, piece.m, b, piece.n, less);
+					const int i1 = CoRank(piece.k1, a, piece.m, b, piece.n, less);
+					const int j0 = piece.k0 - i0;
+					const int j1 = piece.k1 - i1;
+					std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+						std::make_move_iterator(b + j0), std::make_move_iterator(b + j1),
+						dst + piece.aStart + piece.k0, less);
+				}
+			});
+			ts.AddTaskSetToPipe(&task);
+			ts.WaitforTask(&task);
+
+			Swap(src, dst);
+			runs.swap(next);
+		}
+
+		if (src != mem) {
+			const int nPieces = Max(1, size / PARALLEL_MERGE_GRAIN);
+			enki::TaskSet task(uint32_t(nPieces), [&](enki::TaskSetPartition range, uint32_t) {
+				const int start = int(int64_t(size) * range.start / nPieces);
+				const int end = int(int64_t(size) * range.end / nPieces);
+				std::move(src + start, src + end, mem + start);
+			});
+			ts.AddTaskSetToPipe(&task);
+			ts.WaitforTask(&task);
+		}
+		std::destroy(tmp, tmp + size);
+		DefaultAlloc::Free(tmp, sizeof(T) * size, alignof(T));
+	}
+}
+
+template <class T, typename Func>
+void ParallelSort(enki::TaskScheduler& ts, T* mem, int size, Func func)
+{
+	auto sortRun = [&func](T* m, int n) { Sort(m, n, func); };
+	if constexpr (std::is_invocable<Func&, const T&, const T&>::value) {
+		sortimpl::ParallelSort(ts, mem, size, sortRun, func);
+	}
+	else {
+		auto less = [&func](const T& a, const T& b) {
+			return sortimpl::RadixBits(func(a)) < sortimpl::RadixBits(func(b));
+		};
+		sortimpl::ParallelSort(ts, mem, size, sortRun, less);
+	}
+}
+
+template <typename T>
+void ParallelSort(enki::TaskScheduler& ts, T* mem, int size)
+{
+	auto sortRun = [](T* m, int n) { Sort(m, n); };
+	if constexpr (std::is_arithmetic<T>::value) {
+		// Sort() orders numbers by their radix bits; merge the same way.
+		auto less = [](T a, T b) { return sortimpl::RadixBits(a) < sortimpl::RadixBits(b); };
+		sortimpl::ParallelSort(ts, mem, size, sortRun, less);
+	}
+	else {
+		auto less = [](const T& a, const T& b) { return a < b; };
+		sortimpl::ParallelSort(ts, mem, size, sortRun, less);
+	}
+}
+
+} // namespace grinliz
+
+#endif // GRINLIZ_PARALLEL_SORT_INCLUDED
@@ -88,17 +88,18 @@ void grinliz::CSVParser::ParseLine(const char* start, const char* end)
 	GLASSERT(end > start);
 
 	Row row;
+	row.SetArena(m_arena);
 
 	const char* token = start;
 	const char* p = start;
 	while (true) {
 		if (p == end) {
 			if (p > token) 
-				row.emplace_back(std::string_view(token, p - token));
+				row.Push(std::string_view(token, p - token));
 			break;
 		}
 		else if (*p == m_delim) {
-			row.emplace_back(std::string_view(token, p - token));
+			row.Push(std::string_view(token, p - token));
 			++p;
 			token = p;
 		}
@@ -106,5 +107,5 @@ void grinliz::CSVParser::ParseLine(const char* start, const char* end)
 			++p;
 		}
 	}
-	m_rows.emplace_back(row);
+	m_rows.emplace_back(std::move(row));
 }
\ No newline at end of file
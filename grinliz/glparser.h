@@ -4,6 +4,8 @@
 #include <string>
 #include <string_view>
 
+#include "glcontainer.h"
+
 namespace grinliz {
 
 	/*	A simple CSV parser.
@@ -15,6 +17,8 @@ namespace grinliz {
 		not to throw that away while using it.
 
 		Can specify a delimiter on the constructor, it's really a SV parser.
+		If an Arena is given, the storage for the rows is drawn from it; 
+		the Arena must outlive the use of Rows().
 
 		Basic use:
 		```
@@ -31,9 +35,9 @@ namespace grinliz {
 	class CSVParser
 	{
 	public:
-		using Row = std::vector<std::string_view>;
+		using Row = CDynArray<std::string_view>;
 
-		CSVParser(char delim = ',') : m_delim(delim) {}
+		CSVParser(char delim = ',', Arena* arena = 0) : m_delim(delim), m_arena(arena) {}
 
 		// Read a null terminated string of data.
 		void Parse(const char*);
@@ -41,6 +45,7 @@ namespace grinliz {
 	
 	private:
 		char m_delim = 0;
+		Arena* m_arena = 0;
 		std::vector<Row> m_rows;
 
 		void ParseLine(const char* start, const char* end);
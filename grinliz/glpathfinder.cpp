@@ -0,0 +1,206 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glpathfinder.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#include <math.h>
+
+using namespace grinliz;
+
+// Random blocked cells, plus some walls with gaps, like a floor plan.
+template<int SIZE>
+static void MakeMap(Random& random, int percentBlocked, BitArray<SIZE>* map)
+{
+	for (int y = 0; y < SIZE; ++y)
+		for (int x = 0; x < SIZE; ++x)
+			map->Set(x, y, int(random.Rand(100)) >= percentBlocked);
+	for (int w = 0; w < SIZE / 8; ++w) {
+		int x = random.Rand(SIZE), y = random.Rand(SIZE);
+		int len = SIZE / 4;
+		bool horizontal = random.Rand(2) == 0;
+		for (int i = 0; i < len; ++i) {
+			int cx = horizontal ? x + i : x;
+			int cy = horizontal ? y : y + i;
+			if (cx < SIZE && cy < SIZE && i != len / 2)
+				map->Clear(cx, cy);
+		}
+	}
+}
+
+// Checks every step is a legal move, and that they add up to 'cost'.
+template<int SIZE>
+static bool PathValid(const BitArray<SIZE>& map, const CDynArray<GridPoint>& path, GridPoint start, GridPoint end, float cost)
+{
+	if (path.Empty() || path[0] != start || path.Last() != end) return false;
+	float sum = 0;
+	for (int i = 0; i < path.Size(); ++i) {
+		if (!map.IsSet(path[i].x, path[i].y)) return false;
+		if (i == 0) continue;
+		int dx = path[i].x - path[i - 1].x;
+		int dy = path[i].y - path[i - 1].y;
+		if (abs(dx) > 1 || abs(dy) > 1 || (dx == 0 && dy == 0)) return false;
+		if (dx && dy) {
+			if (!map.IsSet(path[i - 1].x + dx, path[i - 1].y) || !map.IsSet(path[i - 1].x, path[i - 1].y + dy))
+				return false;
+			sum += 1.41421356f;
+		}
+		else {
+			sum += 1.0f;
+		}
+	}
+	return fabsf(sum - cost) < 0.01f;
+}
+
+void grinliz::TestPathfinder()
+{
+	typedef GridPathfinder<16> Pathfinder16;
+	// A wall with one gap.
+	{
+		BitArray<16> map;
+		for (int y = 0; y < 16; ++y)
+			for (int x = 0; x < 16; ++x)
+				map.Set(x, y, x != 8 || y == 12);
+
+		Pathfinder16 pf(&map);
+		CDynArray<GridPoint> path;
+		float cost[2] = { 0 };
+		for (int m = 0; m < 2; ++m) {
+			Pathfinder16::Mode mode = m ? Pathfinder16::JUMP_POINT : Pathfinder16::ASTAR;
+			bool found = pf.FindPath({ 2, 2 }, { 14, 2 }, &path, &cost[m], mode);
+			GLASSERT(found);
+			GLASSERT(PathValid(map, path, { 2, 2 }, { 14, 2 }, cost[m]));
+			GLASSERT(path.Find({ 8, 12 }) >= 0);
+
+			found = pf.FindPath({ 3, 3 }, { 3, 3 }, &path, &cost[m], mode);
+			GLASSERT(found);
+			GLASSERT(path.Size() == 1 && cost[m] == 0);
+			found = pf.FindPath({ 3, 3 }, { 8, 3 }, &path, 0, mode);	// into the wall
+			GLASSERT(!found);
+			(void)found;
+		}
+		GLASSERT(fabsf(cost[0] - cost[1]) < 0.01f);
+
+		map.Clear(8, 12);
+		bool aStar = pf.FindPath({ 2, 2 }, { 14, 2 }, &path, 0, Pathfinder16::ASTAR);
+		bool jump = pf.FindPath({ 2, 2 }, { 14, 2 }, &path, 0, Pathfinder16::JUMP_POINT);
+		GLASSERT(!aStar && !jump);
+		(void)aStar;
+		(void)jump;
+	}
+	// Jump point search finds paths as short as A*, on random maps.
+	{
+		typedef GridPathfinder<64> Pathfinder;
+		static const int N_QUERIES = 200;
+		Random random(99);
+		BitArray<64>* map = new BitArray<64>();
+		PathQuery* queries = new PathQuery[N_QUERIES];
+		Pathfinder pf(map);
+		CDynArray<GridPoint> path;
+
+		for (int m = 0; m < 4; ++m) {
+			MakeMap(random, m * 10, map);
+			for (int q = 0; q < N_QUERIES; ++q) {
+				GridPoint start = { int(random.Rand(64)), int(random.Rand(64)) };
+				GridPoint end = { int(random.Rand(64)), int(random.Rand(64)) };
+				queries[q].start = start;
+				queries[q].end = end;
+
+				float aCost = 0, jCost = 0;
+				bool a = pf.FindPath(start, end, &path, &aCost, Pathfinder::ASTAR);
+				GLASSERT(!a || PathValid(*map, path, start, end, aCost));
+				bool j = pf.FindPath(start, end, &path, &jCost, Pathfinder::JUMP_POINT);
+				GLASSERT(!j || PathValid(*map, path, start, end, jCost));
+				GLASSERT(a == j);
+				GLASSERT(!a || fabsf(aCost - jCost) < 0.01f);
+				(void)j;
+				queries[q].cost = a ? aCost : -1;	// the expected result
+			}
+
+#ifdef DEBUG
+			float expected[N_QUERIES];
+			for (int q = 0; q < N_QUERIES; ++q) expected[q] = queries[q].cost;
+#endif
+
+			enki::TaskScheduler ts;
+			ts.Initialize(4);
+			pf.FindPaths(ts, queries, N_QUERIES);
+#ifdef DEBUG
+			for (int q = 0; q < N_QUERIES; ++q) {
+				GLASSERT(fabsf(queries[q].cost - expected[q]) < 0.01f);
+				GLASSERT(expected[q] < 0 || PathValid(*map, queries[q].path, queries[q].start, queries[q].end, queries[q].cost));
+			}
+#endif
+		}
+		delete[] queries;
+		delete map;
+	}
+}
+
+void grinliz::BenchPathfinder()
+{
+	typedef GridPathfinder<1024> Pathfinder;
+	static const int N_AGENTS = 400;
+	Random random(5);
+	BitArray<1024>* map = new BitArray<1024>();
+	MakeMap(random, 0, map);
+	Pathfinder pf(map);
+
+	// Agents going a medium distance. Unreachable goals are left out:
+	// they search the whole map, and would swamp the timing.
+	PathQuery* queries = new PathQuery[N_AGENTS];
+	for (int i = 0; i < N_AGENTS; ++i) {
+		GridPoint start, end;
+		do {
+			start = { int(random.Rand(1024)), int(random.Rand(1024)) };
+			end = { Clamp(start.x + int(random.Rand(257)) - 128, 0, 1023), Clamp(start.y + int(random.Rand(257)) - 128, 0, 1023) };
+		} while (!pf.FindPath(start, end, &queries[i].path, 0));
+		queries[i].start = start;
+		queries[i].end = end;
+	}
+
+	printf("GridPathfinder 1024x1024, %d agents (ms)\n", N_AGENTS);
+	for (int m = 0; m < 2; ++m) {
+		Pathfinder::Mode mode = m ? Pathfinder::JUMP_POINT : Pathfinder::ASTAR;
+		timePoint_t start = Now();
+		for (int i = 0; i < N_AGENTS; ++i)
+			pf.FindPath(queries[i].start, queries[i].end, &queries[i].path, &queries[i].cost, mode);
+		double tSerial = DeltaSeconds(start, Now());
+		printf("  %-10s serial=%7.1f", m ? "jump point" : "A*", tSerial * 1000.0);
+
+		for (int nThreads = 2; nThreads <= int(enki::GetNumHardwareThreads()); nThreads *= 2) {
+			enki::TaskScheduler ts;
+			ts.Initialize(nThreads);
+			pf.FindPaths(ts, queries, nThreads, mode);		// warm up: the first query on a thread allocates
+			start = Now();
+			pf.FindPaths(ts, queries, N_AGENTS, mode);
+			printf("  threads=%d %7.1f", nThreads, DeltaSeconds(start, Now()) * 1000.0);
+		}
+		printf("\n");
+	}
+	delete[] queries;
+	delete map;
+}
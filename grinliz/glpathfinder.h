@@ -0,0 +1,343 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_PATHFINDER_INCLUDED
+#define GRINLIZ_PATHFINDER_INCLUDED
+
+#include <cstdlib>
+
+#include "glcontainer.h"
+#include "enkiTS/TaskScheduler.h"
+
+namespace grinliz
+{
+
+void TestPathfinder();
+void BenchPathfinder();
+
+struct GridPoint
+{
+	int x;
+	int y;
+
+	bool operator==(const GridPoint& rhs) const { return x == rhs.x && y == rhs.y; }
+	bool operator!=(const GridPoint& rhs) const { return !(*this == rhs); }
+};
+
+// A start and end for GridPathfinder::FindPaths(), and the result.
+struct PathQuery
+{
+	GridPoint start;
+	GridPoint end;
+	float cost = 0;					// -1 if there is no path
+	CDynArray<GridPoint> path;		// start to end, every cell
+};
+
+/*	Shortest paths on a SIZE x SIZE grid. Cells set in the BitArray
+	are passable. Moves go to the 8 neighbors: straight costs 1,
+	diagonal costs sqrt(2), and a diagonal can't cut the corner of a 
+	blocked cell.
+
+	JUMP_POINT (jump point search) finds paths of the same cost as
+	ASTAR, but only queues the cells where a path can turn, so it is 
+	much faster on open maps.
+
+	The search memory is kept between calls, so once it has grown a 
+	query doesn't allocate. FindPaths() solves a batch in parallel,
+	with memory for each thread. Don't change the map during a search.
+*/
+template<int SIZE>
+class GridPathfinder
+{
+public:
+	enum Mode { ASTAR, JUMP_POINT };
+
+	GridPathfinder(const BitArray<SIZE>* _map) : map(_map) {}
+
+	// Returns false if there is no path. 'path' gets every cell from
+	// start to end, inclusive. 'cost' may be null.
+	bool FindPath(GridPoint start, GridPoint end, CDynArray<GridPoint>* path, float* cost, Mode mode = JUMP_POINT) {
+		return Search(&scratch, start, end, path, cost, mode);
+	}
+
+	// Solves all the 'queries', spread across the task threads.
+	void FindPaths(enki::TaskScheduler& ts, PathQuery* queries, int n, Mode mode = JUMP_POINT) {
+		const int nThreads = int(ts.GetNumTaskThreads());
+		while (threadScratch.Size() < nThreads)
+			threadScratch.Emplace();
+
+		enki::TaskSet task(uint32_t(n), [&](enki::TaskSetPartition range, uint32_t thread) {
+			Scratch* s = &threadScratch[int(thread)];
+			for (uint32_t i = range.start; i < range.end; ++i) {
+				PathQuery& q = queries[i];
+				if (!Search(s, q.start, q.end, &q.path, &q.cost, mode))
+					q.cost = -1;
+			}
+		});
+		ts.AddTaskSetToPipe(&task);
+		ts.WaitforTask(&task);
+	}
+
+private:
+	static constexpr float DIAGONAL = 1.41421356f;
+
+	struct Scratch {
+		CDynArray<float> g;				// cost from the start
+		CDynArray<int> parent;
+		CDynArray<uint32_t> stamp;		// 2*gen: g and parent are set; 2*gen+1: closed
+		uint32_t gen = 0;
+		IndexedPQueue<AStarNode, 4> open;	// AStarNode::cost is g + heuristic
+	};
+
+	static int Index(int x, int y) { return y * SIZE + x; }
+	static int Dir(int v) { return (v > 0) - (v < 0); }
+
+	bool Walkable(int x, int y) const {
+		return uint32_t(x) < uint32_t(SIZE) && uint32_t(y) < uint32_t(SIZE) && map->IsSet(x, y);
+	}
+
+	// Octile distance: the cost with no obstacles.
+	static float Distance(int x0, int y0, int x1, int y1) {
+		int dx = abs(x1 - x0);
+		int dy = abs(y1 - y0);
+		return float(Max(dx, dy)) + (DIAGONAL - 1.0f) * float(Min(dx, dy));
+	}
+
+	bool Search(Scratch* s, GridPoint start, GridPoint end, CDynArray<GridPoint>* path, float* cost, Mode mode) const {
+		path->Clear();
+		if (!Walkable(start.x, start.y) || !Walkable(end.x, end.y))
+			return false;
+
+		if (s->g.Empty()) {
+			s->g.PushArr(SIZE * SIZE);
+			s->parent.PushArr(SIZE * SIZE);
+			memset(s->stamp.PushArr(SIZE * SIZE), 0, sizeof(uint32_t) * SIZE * SIZE);
+		}
+		// A new generation invalidates all the old stamps without a clear.
+		if (++s->gen == 0x8000'0000u) {
+			memset(s->stamp.Mem(), 0, sizeof(uint32_t) * SIZE * SIZE);
+			s->gen = 1;
+		}
+		const uint32_t seen = s->gen * 2;
+		const int endIndex = Index(end.x, end.y);
+
+		Relax(s, -1, start.x, start.y, 0, end, seen);
+		bool found = false;
+		while (!s->open.Empty()) {
+			const int i = s->open.Pop().index;
+			if (i == endIndex) {
+				found = true;
+				break;
+			}
+			s->stamp[i] = seen + 1;
+			if (mode == JUMP_POINT)
+				ExpandJumpPoint(s, i, end, seen);
+			else
+				ExpandAStar(s, i, end, seen);
+		}
+		s->open.Clear();
+		if (!found)
+			return false;
+
+		if (cost) *cost = s->g[endIndex];
+		BuildPath(s, endIndex, path);
+		return true;
+	}
+
+	void Relax(Scratch* s, int from, int x, int y, float g, GridPoint end, uint32_t seen) const {
+		const int i = Index(x, y);
+		const uint32_t stamp = s->stamp[i];
+		if (stamp == seen + 1)
+			return;
+		if (stamp != seen || g < s->g[i]) {
+			s->stamp[i] = seen;
+			s->g[i] = g;
+			s->parent[i] = from;
+			s->open.Set({ i, g + Distance(x, y, end.x, end.y) });
+		}
+	}
+
+	void ExpandAStar(Scratch* s, int i, GridPoint end, uint32_t seen) const {
+		const int x = i % SIZE;
+		const int y = i / SIZE;
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (!CanStep(x, y, dx, dy))
+					continue;
+				Relax(s, i, x + dx, y + dy, s->g[i] + ((dx && dy) ? DIAGONAL : 1.0f), end, seen);
+			}
+		}
+	}
+
+	// True if (x, y) can move one cell in (dx, dy), without cutting a corner.
+	bool CanStep(int x, int y, int dx, int dy) const {
+		if ((dx == 0 && dy == 0) || !Walkable(x + dx, y + dy))
+			return false;
+		return !(dx && dy) || (Walkable(x + dx, y) && Walkable(x, y + dy));
+	}
+
+	/*	Jump point search, for 8 way movement that can't cut corners.
+		Only the neighbors that can't be reached better some other way
+		are searched (the rest are "pruned"), and each search runs in 
+		a straight line until it hits the goal or a cell where the path
+		may need to turn (a "jump point".) Only jump points are queued.
+	*/
+	void ExpandJumpPoint(Scratch* s, int i, GridPoint end, uint32_t seen) const {
+		const int x = i % SIZE;
+		const int y = i / SIZE;
+		const int p = s->parent[i];
+
+		int dirs[8][2];
+		int nDirs = 0;
+		auto add = [&](int dx, int dy) {
+			dirs[nDirs][0] = dx;
+			dirs[nDirs][1] = dy;
+			++nDirs;
+		};
+
+		if (p < 0) {
+			for (int dy = -1; dy <= 1; ++dy)
+				for (int dx = -1; dx <= 1; ++dx)
+					if (CanStep(x, y, dx, dy)) add(dx, dy);
+		}
+		else {
+			const int dx = Dir(x - p % SIZE);
+			const int dy = Dir(y - p / SIZE);
+			if (dx && dy) {
+				const bool nextX = Walkable(x + dx, y);
+				const bool nextY = Walkable(x, y + dy);
+				if (nextY) add(0, dy);
+				if (nextX) add(dx, 0);
+				if (nextX && nextY && Walkable(x + dx, y + dy)) add(dx, dy);
+			}
+			else if (dx) {
+				const bool next = Walkable(x + dx, y);
+				const bool up = Walkable(x, y + 1);
+				const bool down = Walkable(x, y - 1);
+				if (next) {
+					add(dx, 0);
+					if (up && Walkable(x + dx, y + 1)) add(dx, 1);
+					if (down && Walkable(x + dx, y - 1)) add(dx, -1);
+				}
+				if (up) add(0, 1);
+				if (down) add(0, -1);
+			}
+			else {
+				const bool next = Walkable(x, y + dy);
+				const bool right = Walkable(x + 1, y);
+				const bool left = Walkable(x - 1, y);
+				if (next) {
+					add(0, dy);
+					if (right && Walkable(x + 1, y + dy)) add(1, dy);
+					if (left && Walkable(x - 1, y + dy)) add(-1, dy);
+				}
+				if (right) add(1, 0);
+				if (left) add(-1, 0);
+			}
+		}
+
+		for (int d = 0; d < nDirs; ++d) {
+			const int dx = dirs[d][0];
+			const int dy = dirs[d][1];
+			const int j = (dx && dy) ? JumpDiagonal(x + dx, y + dy, dx, dy, end)
+				                     : JumpStraight(x + dx, y + dy, dx, dy, end);
+			if (j >= 0) {
+				const int jx = j % SIZE;
+				const int jy = j / SIZE;
+				Relax(s, i, jx, jy, s->g[i] + Distance(x, y, jx, jy), end, seen);
+			}
+		}
+	}
+
+	// Runs from (x, y) in a straight line; returns the jump point or -1.
+	int JumpStraight(int x, int y, int dx, int dy, GridPoint end) const {
+		while (Walkable(x, y)) {
+			if (x == end.x && y == end.y)
+				return Index(x, y);
+			// A wall behind a side opening: the path may turn here.
+			if (dx) {
+				if ((Walkable(x, y - 1) && !Walkable(x - dx, y - 1)) || (Walkable(x, y + 1) && !Walkable(x - dx, y + 1)))
+					return Index(x, y);
+			}
+			else {
+				if ((Walkable(x - 1, y) && !Walkable(x - 1, y - dy)) || (Walkable(x + 1, y) && !Walkable(x + 1, y - dy)))
+					return Index(x, y);
+			}
+			x += dx;
+			y += dy;
+		}
+		return -1;
+	}
+
+	// Runs from (x, y) diagonally; returns the jump point or -1.
+	int JumpDiagonal(int x, int y, int dx, int dy, GridPoint end) const {
+		while (Walkable(x, y)) {
+			if (x == end.x && y == end.y)
+				return Index(x, y);
+			// A jump point on either straight line makes this one too.
+			if (JumpStraight(x + dx, y, dx, 0, end) >= 0 || JumpStraight(x, y + dy, 0, dy, end) >= 0)
+				return Index(x, y);
+			if (!Walkable(x + dx, y) || !Walkable(x, y + dy))
+				return -1;
+			x += dx;
+			y += dy;
+		}
+		return -1;
+	}
+
+	// Fills in every cell; jump points can be many cells apart.
+	void BuildPath(const Scratch* s, int endIndex, CDynArray<GridPoint>* path) const {
+		int n = 1;
+		for (int i = endIndex; s->parent[i] >= 0; i = s->parent[i]) {
+			const int p = s->parent[i];
+			n += Max(abs(i % SIZE - p % SIZE), abs(i / SIZE - p / SIZE));
+		}
+		GridPoint* out = path->PushArr(n) + n;
+		for (int i = endIndex; i >= 0; i = s->parent[i]) {
+			GridPoint pt = { i % SIZE, i / SIZE };
+			const int p = s->parent[i];
+			if (p < 0) {
+				*--out = pt;
+				break;
+			}
+			const int dx = Dir(p % SIZE - pt.x);
+			const int dy = Dir(p / SIZE - pt.y);
+			while (Index(pt.x, pt.y) != p) {
+				*--out = pt;
+				pt.x += dx;
+				pt.y += dy;
+			}
+		}
+		GLASSERT(out == path->Mem());
+	}
+
+	const BitArray<SIZE>* map;
+	Scratch scratch;
+	DynArray<Scratch> threadScratch;
+};
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_PATHFINDER_INCLUDED
@@ -46,12 +46,12 @@ namespace grinliz {
 	{
 	public:
 		QuickProfile(const char* name) {
-			startTime = std::chrono::high_resolution_clock::now();
+			startTime = Now();
 			this->name = name;
 		}
 
 		~QuickProfile() {
-			auto endTime = std::chrono::high_resolution_clock::now();
+			auto endTime = Now();
 			std::chrono::microseconds micro = std::chrono::duration_cast<std::chrono::microseconds>(
 				endTime - startTime
 				);
@@ -59,7 +59,7 @@ namespace grinliz {
 		}
 
 	private:
-		std::chrono::steady_clock::time_point startTime;
+		timePoint_t startTime;
 		const char* name;
 	};
 }
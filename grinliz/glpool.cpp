@@ -0,0 +1,351 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glpool.h"
+#include "glrandom.h"
+#include "glperformance.h"
+#include "gltask.h"
+
+#include <thread>
+
+using namespace grinliz;
+
+FixedBlockAllocator::FixedBlockAllocator(size_t size, size_t chunk)
+{
+	const size_t align = size >= 16 ? 16 : sizeof(Node);
+	blockSize = (Max(size, sizeof(Node)) + align - 1) & ~(align - 1);
+	chunkSize = Max(chunk, blockSize);
+}
+
+FixedBlockAllocator::~FixedBlockAllocator()
+{
+	for (void* c : chunks)
+		DefaultAlloc::Free(c, chunkSize, 16);
+}
+
+void FixedBlockAllocator::NewChunk()
+{
+	uint8_t* mem = (uint8_t*)DefaultAlloc::Alloc(chunkSize, 16);
+	chunks.Push(mem);
+
+	// Link in address order, so new blocks are handed out in order.
+	const size_t n = chunkSize / blockSize;
+	for (size_t i = 0; i < n - 1; ++i)
+		((Node*)(mem + i * blockSize))->next = (Node*)(mem + (i + 1) * blockSize);
+	((Node*)(mem + (n - 1) * blockSize))->next = freeList;
+	freeList = (Node*)mem;
+}
+
+namespace {
+	// Hands out the thread indices, and takes them back when a thread exits.
+	struct ThreadIndices {
+		std::mutex mutex;
+		CDynArray<int> free;
+		int next = 0;
+	};
+	ThreadIndices& Indices() {
+		// Never deleted: threads may exit during static destruction.
+		static ThreadIndices* indices = new ThreadIndices();
+		return *indices;
+	}
+
+	struct ThreadSlot {
+		int index;
+		ThreadSlot() {
+			ThreadIndices& t = Indices();
+			std::lock_guard<std::mutex> lock(t.mutex);
+			index = t.free.Size() ? t.free.Pop() : t.next++;
+		}
+		~ThreadSlot() {
+			ThreadIndices& t = Indices();
+			std::lock_guard<std::mutex> lock(t.mutex);
+			t.free.Push(index);
+		}
+	};
+}
+
+int ConcurrentBlockAllocator::ThreadIndex()
+{
+	static thread_local ThreadSlot slot;
+	return slot.index;
+}
+
+void ConcurrentBlockAllocator::Refill(Cache& c)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < BATCH; ++i) {
+		Node* n = (Node*)shared.Alloc();
+		n->next = c.head;
+		c.head = n;
+	}
+	c.count.store(c.count.load(std::memory_order_relaxed) + BATCH, std::memory_order_relaxed);
+}
+
+void ConcurrentBlockAllocator::Flush(Cache& c)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < BATCH; ++i) {
+		Node* n = c.head;
+		c.head = n->next;
+		shared.Free(n);
+	}
+	c.count.store(c.count.load(std::memory_order_relaxed) - BATCH, std::memory_order_relaxed);
+}
+
+int ConcurrentBlockAllocator::NumAllocated()
+{
+	int cached = 0;
+	for (const Cache& c : caches)
+		cached += c.count.load(std::memory_order_relaxed);
+	std::lock_guard<std::mutex> lock(mutex);
+	return shared.NumAllocated() - cached;
+}
+
+size_t ConcurrentBlockAllocator::MemoryInUse()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return shared.MemoryInUse() + sizeof(caches);
+}
+
+namespace {
+	static const size_t SMALL_STEP = 32;
+	static const int N_SMALL = int(MAX_SMALL_ALLOC / SMALL_STEP);
+
+	ConcurrentBlockAllocator** SmallAllocators() {
+		// Never deleted: objects may be freed during static destruction.
+		static ConcurrentBlockAllocator** allocators = [] {
+			ConcurrentBlockAllocator** a = new ConcurrentBlockAllocator*[N_SMALL];
+			for (int i = 0; i < N_SMALL; ++i)
+				a[i] = new ConcurrentBlockAllocator((i + 1) * SMALL_STEP);
+			return a;
+		}();
+		return allocators;
+	}
+}
+
+void* grinliz::SmallAlloc(size_t size)
+{
+	if (size == 0 || size > MAX_SMALL_ALLOC)
+		return DefaultAlloc::Alloc(size, MALLOC_ALIGN);
+	return SmallAllocators()[(size - 1) / SMALL_STEP]->Alloc();
+}
+
+void grinliz::SmallFree(void* p, size_t size)
+{
+	if (size == 0 || size > MAX_SMALL_ALLOC)
+		DefaultAlloc::Free(p, size, MALLOC_ALIGN);
+	else
+		SmallAllocators()[(size - 1) / SMALL_STEP]->Free(p);
+}
+
+size_t grinliz::SmallAllocMemoryInUse()
+{
+	size_t total = 0;
+	for (int i = 0; i < N_SMALL; ++i)
+		total += SmallAllocators()[i]->MemoryInUse();
+	return total;
+}
+
+namespace {
+	struct PoolTestObj {
+		static int count;
+		int a;
+		DynArray<int> arr;
+		PoolTestObj(int v) : a(v) { ++count; arr.Push(v); }
+		~PoolTestObj() { --count; }
+	};
+	int PoolTestObj::count = 0;
+
+	struct CountTask : SelfDeletingTask {
+		std::atomic<int>* counter;
+		char payload[40];
+		CountTask(std::atomic<int>* c) : counter(c) {}
+		void ExecuteRange(enki::TaskSetPartition, uint32_t) override { ++(*counter); }
+	};
+}
+
+void grinliz::TestPool()
+{
+	{
+		FixedBlockAllocator alloc(20, 1024);
+		GLASSERT(alloc.BlockSize() == 32);
+		void* p[100];
+		for (int i = 0; i < 100; ++i) {
+			p[i] = alloc.Alloc();
+			GLASSERT(((uintptr_t)p[i] & 15) == 0);
+			memset(p[i], i, 20);
+		}
+		GLASSERT(alloc.NumAllocated() == 100);
+		GLASSERT(alloc.NumChunks() == (100 + 31) / 32);
+		for (int i = 0; i < 100; ++i)
+			GLASSERT(((uint8_t*)p[i])[19] == uint8_t(i));
+		for (int i = 0; i < 100; i += 2)
+			alloc.Free(p[i]);
+		GLASSERT(alloc.NumAllocated() == 50);
+		// Freed blocks are reused before new chunks are made.
+		int chunks = alloc.NumChunks();
+		for (int i = 0; i < 100; i += 2)
+			p[i] = alloc.Alloc();
+		GLASSERT(alloc.NumChunks() == chunks);
+		GLASSERT(alloc.MemoryInUse() == size_t(chunks) * 1024);
+		(void)chunks;
+	}
+	{
+		Pool<PoolTestObj> pool;
+		PoolTestObj* objs[1000];
+		for (int i = 0; i < 1000; ++i)
+			objs[i] = pool.New(i);
+		GLASSERT(PoolTestObj::count == 1000 && pool.NumAllocated() == 1000);
+		for (int i = 0; i < 1000; ++i) {
+			GLASSERT(objs[i]->a == i && objs[i]->arr[0] == i);
+			pool.Delete(objs[i]);
+		}
+		GLASSERT(PoolTestObj::count == 0 && pool.NumAllocated() == 0);
+		pool.Delete(0);
+	}
+	{
+		// Threads allocate, and free each other's blocks.
+		static const int THREADS = 4;
+		static const int N = 20000;
+		ConcurrentBlockAllocator alloc(48);
+		uint32_t** blocks = new uint32_t*[THREADS * N];
+		std::atomic<int> errors = { 0 };
+		auto work = [&](int t) {
+			Random random(t + 1);
+			for (int i = 0; i < N; ++i) {
+				uint32_t* p = (uint32_t*)alloc.Alloc();
+				p[0] = uint32_t(t * N + i);
+				blocks[t * N + i] = p;
+				if (random.Rand(4) == 0)
+					alloc.Free(alloc.Alloc());
+			}
+		};
+		std::thread threads[THREADS];
+		for (int t = 0; t < THREADS; ++t)
+			threads[t] = std::thread(work, t);
+		for (int t = 0; t < THREADS; ++t)
+			threads[t].join();
+		GLASSERT(alloc.NumAllocated() == THREADS * N);
+
+		for (int t = 0; t < THREADS; ++t) {
+			threads[t] = std::thread([&](int t) {
+				// Free the blocks of the next thread over.
+				int base = ((t + 1) % THREADS) * N;
+				for (int i = 0; i < N; ++i) {
+					if (blocks[base + i][0] != uint32_t(base + i))
+						errors++;
+					alloc.Free(blocks[base + i]);
+				}
+			}, t);
+		}
+		for (int t = 0; t < THREADS; ++t)
+			threads[t].join();
+		GLASSERT(errors == 0);
+		GLASSERT(alloc.NumAllocated() == 0);
+		delete[] blocks;
+	}
+	{
+		// SelfDeletingTasks come from the small allocators.
+		static const int TASKS = 200;
+		std::atomic<int> counter = { 0 };
+		enki::TaskScheduler ts;
+		ts.Initialize(4);
+		for (int i = 0; i < TASKS; ++i)
+			ts.AddTaskSetToPipe(new CountTask(&counter));
+		ts.WaitforAllAndShutdown();
+		GLASSERT(counter == TASKS);
+		GLASSERT(SmallAllocMemoryInUse() > 0);
+
+		void* big = SmallAlloc(MAX_SMALL_ALLOC + 1);
+		SmallFree(big, MAX_SMALL_ALLOC + 1);
+	}
+}
+
+void grinliz::BenchPool()
+{
+	static const int N = 100000;
+	static const int REPEAT = 20;
+	static const size_t SIZE = 96;
+	void** p = new void*[N];
+	Random random(17);
+	int* order = new int[N];
+	for (int i = 0; i < N; ++i) order[i] = i;
+	for (int i = N - 1; i > 0; --i) Swap(order[i], order[random.Rand(i + 1)]);
+
+	// Allocate N, free them in random order.
+	timePoint_t start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int i = 0; i < N; ++i) p[i] = malloc(SIZE);
+		for (int i = 0; i < N; ++i) free(p[order[i]]);
+	}
+	double tMalloc = DeltaSeconds(start, Now());
+
+	FixedBlockAllocator fixed(SIZE);
+	start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int i = 0; i < N; ++i) p[i] = fixed.Alloc();
+		for (int i = 0; i < N; ++i) fixed.Free(p[order[i]]);
+	}
+	double tFixed = DeltaSeconds(start, Now());
+
+	ConcurrentBlockAllocator concurrent(SIZE);
+	start = Now();
+	for (int r = 0; r < REPEAT; ++r) {
+		for (int i = 0; i < N; ++i) p[i] = concurrent.Alloc();
+		for (int i = 0; i < N; ++i) concurrent.Free(p[order[i]]);
+	}
+	double tConcurrent = DeltaSeconds(start, Now());
+
+	// Many threads, each with its own churn of objects.
+	static const int THREADS = 4;
+	auto threaded = [](auto alloc, auto release) {
+		timePoint_t start = Now();
+		std::thread threads[THREADS];
+		for (int t = 0; t < THREADS; ++t) {
+			threads[t] = std::thread([&]() {
+				void* live[256] = { 0 };
+				for (int i = 0; i < N * REPEAT / THREADS; ++i) {
+					int k = i & 255;
+					release(live[k]);
+					live[k] = alloc();
+				}
+				for (void* v : live) release(v);
+			});
+		}
+		for (int t = 0; t < THREADS; ++t)
+			threads[t].join();
+		return DeltaSeconds(start, Now());
+	};
+	double tMallocMT = threaded([]() { return malloc(SIZE); }, [](void* v) { free(v); });
+	double tConcurrentMT = threaded([&]() { return concurrent.Alloc(); }, [&](void* v) { concurrent.Free(v); });
+
+	const double ns = 1e9 / (double(N) * REPEAT);
+	printf("Alloc+free %d byte blocks (ns): malloc=%.1f Fixed=%.1f Concurrent=%.1f  %d threads: malloc=%.1f Concurrent=%.1f  memory=%dk\n",
+		int(SIZE), tMalloc * ns, tFixed * ns, tConcurrent * ns, THREADS, tMallocMT * ns, tConcurrentMT * ns,
+		int(concurrent.MemoryInUse() / 1024));
+
+	delete[] order;
+	delete[] p;
+}
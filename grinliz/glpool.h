@@ -0,0 +1,209 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_POOL_INCLUDED
+#define GRINLIZ_POOL_INCLUDED
+
+#include <atomic>
+#include <mutex>
+
+#include "glcontainer.h"
+
+namespace grinliz
+{
+
+void TestPool();
+void BenchPool();
+
+/*	Hands out blocks of one size, carved from large chunks. The free
+	blocks are kept in a list threaded through the blocks themselves,
+	so Alloc and Free are a couple of pointer moves. Chunks are only 
+	returned to the system when the allocator is destroyed. Blocks are
+	aligned to 16 bytes (8 if the block is smaller.)
+	Not thread safe; see ConcurrentBlockAllocator.
+*/
+class FixedBlockAllocator
+{
+public:
+	FixedBlockAllocator(size_t blockSize, size_t chunkSize = 64 * 1024);
+	~FixedBlockAllocator();
+
+	void* Alloc() {
+		if (!freeList)
+			NewChunk();
+		Node* n = freeList;
+		freeList = n->next;
+		++nAllocated;
+		return n;
+	}
+
+	void Free(void* p) {
+		if (!p) return;
+		Node* n = (Node*)p;
+		n->next = freeList;
+		freeList = n;
+		--nAllocated;
+	}
+
+	size_t BlockSize() const { return blockSize; }
+	int NumAllocated() const { return nAllocated; }
+	int NumChunks() const { return chunks.Size(); }
+	// Memory taken from the system.
+	size_t MemoryInUse() const { return chunks.Size() * chunkSize; }
+
+private:
+	FixedBlockAllocator(const FixedBlockAllocator&);
+	void operator=(const FixedBlockAllocator&);
+	friend class ConcurrentBlockAllocator;
+
+	struct Node {
+		Node* next;
+	};
+	void NewChunk();
+
+	size_t blockSize;
+	size_t chunkSize;
+	Node* freeList = 0;
+	int nAllocated = 0;
+	CDynArray<void*> chunks;
+};
+
+/*	Objects of type T, allocated from a FixedBlockAllocator.
+	Not thread safe.
+*/
+template<class T>
+class Pool
+{
+public:
+	Pool(size_t chunkSize = 64 * 1024) : alloc(sizeof(T), chunkSize) {
+		static_assert(alignof(T) <= 16, "Pool blocks are 16 byte aligned.");
+	}
+
+	template<class... Args>
+	T* New(Args&&... args) {
+		return new (alloc.Alloc()) T(std::forward<Args>(args)...);
+	}
+
+	void Delete(T* t) {
+		if (!t) return;
+		t->~T();
+		alloc.Free(t);
+	}
+
+	int NumAllocated() const { return alloc.NumAllocated(); }
+	size_t MemoryInUse() const { return alloc.MemoryInUse(); }
+
+private:
+	FixedBlockAllocator alloc;
+};
+
+/*	A FixedBlockAllocator for any thread. Each thread has its own cache
+	of free blocks, so Alloc and Free don't lock, or share a cache line
+	with another thread. A cache trades BATCH blocks at a time with the
+	shared allocator (under a lock) when it runs dry or fills up.
+
+	A block may be freed on a different thread than it was allocated
+	on. A thread's cache is handed on to the next thread to start when
+	it exits. Past MAX_THREADS running threads, the extra threads lock
+	for every Alloc and Free.
+*/
+class ConcurrentBlockAllocator
+{
+public:
+	static const int MAX_THREADS = 64;
+	static const int BATCH = 32;
+
+	ConcurrentBlockAllocator(size_t blockSize, size_t chunkSize = 64 * 1024) : shared(blockSize, chunkSize) {}
+
+	void* Alloc() {
+		int t = ThreadIndex();
+		if (t >= MAX_THREADS) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return shared.Alloc();
+		}
+		Cache& c = caches[t];
+		if (!c.head)
+			Refill(c);
+		Node* n = c.head;
+		c.head = n->next;
+		c.count.store(c.count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+		return n;
+	}
+
+	void Free(void* p) {
+		if (!p) return;
+		int t = ThreadIndex();
+		if (t >= MAX_THREADS) {
+			std::lock_guard<std::mutex> lock(mutex);
+			shared.Free(p);
+			return;
+		}
+		Cache& c = caches[t];
+		Node* n = (Node*)p;
+		n->next = c.head;
+		c.head = n;
+		int count = c.count.load(std::memory_order_relaxed) + 1;
+		c.count.store(count, std::memory_order_relaxed);
+		if (count >= BATCH * 2)
+			Flush(c);
+	}
+
+	size_t BlockSize() const { return shared.BlockSize(); }
+	// Blocks in use. Only a snapshot while other threads are working.
+	int NumAllocated();
+	size_t MemoryInUse();
+
+	// A small number for each running thread, reused when threads exit.
+	static int ThreadIndex();
+
+private:
+	typedef FixedBlockAllocator::Node Node;
+	struct alignas(64) Cache {
+		Node* head = 0;
+		std::atomic<int> count = { 0 };		// read by NumAllocated()
+	};
+	void Refill(Cache& c);
+	void Flush(Cache& c);
+
+	std::mutex mutex;
+	FixedBlockAllocator shared;
+	Cache caches[MAX_THREADS];
+};
+
+/*	General purpose allocation of small objects, from a set of shared
+	ConcurrentBlockAllocators, one for each multiple of 32 bytes up to
+	MAX_SMALL_ALLOC. Bigger sizes use DefaultAlloc. The size passed to 
+	SmallFree must be the one passed to SmallAlloc, which is what a
+	class's operator delete(void*, size_t) is given.
+*/
+static const size_t MAX_SMALL_ALLOC = 512;
+void* SmallAlloc(size_t size);
+void SmallFree(void* p, size_t size);
+// Memory taken from the system by the small allocators.
+size_t SmallAllocMemoryInUse();
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_POOL_INCLUDED
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+
+#include "glsoa.h"
+#include "glcontainer.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#include <stdio.h>
+
+using namespace grinliz;
+
+void grinliz::TestSoA()
+{
+	{
+		SoAArray<float, int, uint8_t> arr;
+		GLASSERT(arr.Empty());
+		for (int i = 0; i < 100; ++i) {
+			int index = arr.Push(float(i), i * 10, uint8_t(i));
+			GLASSERT(index == i);
+			(void)index;
+		}
+		GLASSERT(arr.Size() == 100);
+		GLASSERT(((uintptr_t)arr.Column<0>().data & 63) == 0);
+		GLASSERT(((uintptr_t)arr.Column<1>().data & 63) == 0);
+		GLASSERT(((uintptr_t)arr.Column<2>().data & 63) == 0);
+
+		ColumnSpan<int> ints = arr.Column<1>();
+		GLASSERT(ints.Size() == 100);
+		for (int i = 0; i < 100; ++i)
+			GLASSERT(ints[i] == i * 10);
+		(void)ints;
+
+		arr[5].Get<1>() = -5;
+		GLASSERT(arr.Column<1>()[5] == -5);
+		arr[6].Set(1.5f, 2, 3);
+		GLASSERT(arr[6].Get<0>() == 1.5f && arr[6].Get<1>() == 2 && arr[6].Get<2>() == 3);
+		GLASSERT(std::get<1>(arr[7].Tuple()) == 70);
+
+		// SwapRemove moves the last row, in every column.
+		arr.SwapRemove(10);
+		GLASSERT(arr.Size() == 99);
+		GLASSERT(arr[10].Get<0>() == 99.0f && arr[10].Get<1>() == 990 && arr[10].Get<2>() == 99);
+		arr.SwapRemove(arr.Size() - 1);
+		GLASSERT(arr.Size() == 98);
+
+		const SoAArray<float, int, uint8_t>& c = arr;
+		GLASSERT(c[10].Get<1>() == 990);
+		(void)c;
+
+		SoAArray<float, int, uint8_t> copy = arr;
+		GLASSERT(copy.Size() == 98 && copy[10].Get<1>() == 990);
+		SoAArray<float, int, uint8_t> moved = std::move(copy);
+		GLASSERT(moved.Size() == 98 && copy.Size() == 0);
+	}
+	{
+		// Sorting by a column carries the other columns along.
+		Random random(7);
+		SoAArray<float, int, double> arr;
+		static const int N = 1000;
+		for (int i = 0; i < N; ++i) {
+			float f = random.Uniform() - 0.5f;
+			arr.Push(f, i, double(f) * 2.0);
+		}
+		arr.SortByColumn<0>();
+		for (int i = 0; i < N; ++i) {
+			GLASSERT(arr[i].Get<2>() == double(arr[i].Get<0>()) * 2.0);
+			GLASSERT(i == 0 || arr[i - 1].Get<0>() <= arr[i].Get<0>());
+		}
+
+		// Descending, with a less function; then back to the order added.
+		arr.SortByColumn<2>([](double a, double b) { return a > b; });
+		for (int i = 1; i < N; ++i)
+			GLASSERT(arr[i - 1].Get<2>() >= arr[i].Get<2>());
+		arr.SortByColumn<1>();
+		for (int i = 0; i < N; ++i)
+			GLASSERT(arr[i].Get<1>() == i);
+	}
+}
+
+void grinliz::BenchSoA()
+{
+	// A hot loop that reads 2 of 8 fields.
+	struct Particle {
+		float x, y, z;
+		float vx, vy, vz;
+		uint32_t color;
+		int id;
+	};
+	static const int N = 1'000'000;
+	static const int PASSES = 50;
+
+	Random random(3);
+	CDynArray<Particle> aos;
+	SoAArray<float, float, float, float, float, float, uint32_t, int> soa;
+	aos.Reserve(N);
+	soa.Reserve(N);
+	for (int i = 0; i < N; ++i) {
+		Particle p = { random.Uniform(), random.Uniform(), random.Uniform(), 0, 0, 0, 0xffffffff, i };
+		aos.Push(p);
+		soa.Push(p.x, p.y, p.z, p.vx, p.vy, p.vz, p.color, p.id);
+	}
+
+	int countAoS = 0;
+	timePoint_t start = Now();
+	for (int pass = 0; pass < PASSES; ++pass) {
+		for (const Particle& p : aos)
+			countAoS += (p.x < 0.5f) & (p.y < 0.5f);
+	}
+	double tAoS = DeltaSeconds(start, Now());
+
+	int countSoA = 0;
+	start = Now();
+	for (int pass = 0; pass < PASSES; ++pass) {
+		const float* x = soa.Column<0>().data;
+		const float* y = soa.Column<1>().data;
+		for (int i = 0; i < N; ++i)
+			countSoA += (x[i] < 0.5f) & (y[i] < 0.5f);
+	}
+	double tSoA = DeltaSeconds(start, Now());
+	GLASSERT(countAoS == countSoA);
+
+	start = Now();
+	soa.SortByColumn<0>();
+	double tSort = DeltaSeconds(start, Now());
+
+	printf("Points in box, %d particles (ms/pass): CDynArray=%.3f SoAArray=%.3f  sort by column=%.1f ms (count=%d/%d)\n",
+		N, tAoS * 1000.0 / PASSES, tSoA * 1000.0 / PASSES, tSort * 1000.0, countAoS / PASSES, countSoA / PASSES);
+}
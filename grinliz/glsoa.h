@@ -0,0 +1,320 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+
+#ifndef GRINLIZ_SOA_INCLUDED
+#define GRINLIZ_SOA_INCLUDED
+
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "gldebug.h"
+#include "glutil.h"
+#include "glsort.h"
+#include "glmemory.h"
+
+namespace grinliz
+{
+
+void TestSoA();
+void BenchSoA();
+
+// A typed view of contiguous memory; the columns of a SoAArray.
+template<class T>
+struct ColumnSpan
+{
+	T* data;
+	int size;
+
+	T* begin() const { return data; }
+	T* end() const { return data + size; }
+	T& operator[](int i) const { GLASSERT(i >= 0 && i < size); return data[i]; }
+	int Size() const { return size; }
+	bool Empty() const { return size == 0; }
+};
+
+/*	A structure-of-arrays: every field is stored in its own array, so a
+	loop over one field reads only that field's memory. Each column is 
+	aligned to COLUMN_ALIGN bytes, and all of them share one size, one
+	capacity, and one allocation (from DefaultAlloc.)
+
+	SoAArray<Vec2F, int> points;
+	points.Push(pos, value);
+	ColumnSpan<Vec2F> pos = points.Column<0>();	// for a SIMD kernel
+	points[3].Get<1>() = 4;							// a row at a time
+
+	Fields must be blittable, like CDynArray. Any operation that
+	changes the size (or sorts) keeps the columns in sync.
+*/
+template<class... Fields>
+class SoAArray
+{
+public:
+	static constexpr int NUM_FIELDS = sizeof...(Fields);
+	static constexpr size_t COLUMN_ALIGN = 64;
+	static_assert(NUM_FIELDS > 0, "SoAArray needs at least one field");
+	static_assert((std::is_trivially_copyable<Fields>::value && ...), "SoAArray fields must be blittable");
+	static_assert(((alignof(Fields) <= COLUMN_ALIGN) && ...), "field alignment is limited to COLUMN_ALIGN");
+
+	template<int I>
+	using FieldType = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+	// A reference to one row; valid until the array is resized.
+	template<class Array>
+	class RowRef
+	{
+	public:
+		RowRef(Array* a, int index) : array(a), index(index) {}
+
+		template<int I>
+		auto& Get() const { return array->template Column<I>()[index]; }
+
+		void Set(const Fields&... fields) const { array->SetRow(index, fields...); }
+		std::tuple<Fields...> Tuple() const { return array->RowTuple(index); }
+		int Index() const { return index; }
+
+	private:
+		Array* array;
+		int index;
+	};
+	using Row = RowRef<SoAArray>;
+	using ConstRow = RowRef<const SoAArray>;
+
+	SoAArray() {}
+	SoAArray(const SoAArray& rhs) { *this = rhs; }
+	SoAArray(SoAArray&& rhs) noexcept { *this = std::move(rhs); }
+	~SoAArray() { FreeMem(); }
+
+	void operator=(const SoAArray& rhs) {
+		if (this == &rhs) return;
+		Clear();
+		EnsureCap(rhs.size);
+		for (int i = 0; i < NUM_FIELDS; ++i)
+			if (rhs.size) memcpy(cols[i], rhs.cols[i], rhs.size * SIZES[i]);
+		size = rhs.size;
+	}
+
+	void operator=(SoAArray&& rhs) {
+		if (this == &rhs) return;
+		FreeMem();
+		mem = rhs.mem;
+		size = rhs.size;
+		capacity = rhs.capacity;
+		for (int i = 0; i < NUM_FIELDS; ++i)
+			cols[i] = rhs.cols[i];
+		rhs.mem = 0;
+		rhs.size = rhs.capacity = 0;
+		for (int i = 0; i < NUM_FIELDS; ++i)
+			rhs.cols[i] = 0;
+	}
+
+	int Size() const { return size; }
+	int Capacity() const { return capacity; }
+	bool Empty() const { return size == 0; }
+	void Clear() { size = 0; }
+
+	void FreeMem() {
+		DefaultAlloc::Free(mem, AllocSize(capacity), COLUMN_ALIGN);
+		mem = 0;
+		size = capacity = 0;
+		for (int i = 0; i < NUM_FIELDS; ++i)
+			cols[i] = 0;
+	}
+
+	void Reserve(int n) { EnsureCap(n); }
+	void EnsureCap(int count) {
+		if (count > capacity)
+			Reallocate(Max(int(CeilPowerOf2(uint32_t(count))), 16));
+	}
+
+	// Returns the index of the new row.
+	int Push(const Fields&... fields) {
+		EnsureCap(size + 1);
+		SetRow(size, fields...);
+		return size++;
+	}
+
+	// Adds 'count' rows, uninitialized, and returns the index of the first.
+	int PushArr(int count) {
+		EnsureCap(size + count);
+		int start = size;
+		size += count;
+		return start;
+	}
+
+	void Pop() {
+		GLASSERT(size > 0);
+		--size;
+	}
+
+	// Moves the last row to 'i'; doesn't preserve the order.
+	void SwapRemove(int i) {
+		GLASSERT(i >= 0 && i < size);
+		const int last = size - 1;
+		if (i != last) {
+			for (int c = 0; c < NUM_FIELDS; ++c) {
+				uint8_t* col = (uint8_t*)cols[c];
+				memcpy(col + i * SIZES[c], col + last * SIZES[c], SIZES[c]);
+			}
+		}
+		--size;
+	}
+
+	template<int I>
+	ColumnSpan<FieldType<I>> Column() { return { (FieldType<I>*)cols[I], size }; }
+	template<int I>
+	ColumnSpan<const FieldType<I>> Column() const { return { (const FieldType<I>*)cols[I], size }; }
+
+	Row operator[](int i) { GLASSERT(i >= 0 && i < size); return Row(this, i); }
+	ConstRow operator[](int i) const { GLASSERT(i >= 0 && i < size); return ConstRow(this, i); }
+
+	void SetRow(int i, const Fields&... fields) {
+		SetRowImpl(i, std::index_sequence_for<Fields...>(), fields...);
+	}
+	std::tuple<Fields...> RowTuple(int i) const {
+		GLASSERT(i >= 0 && i < size);
+		return RowTupleImpl(i, std::index_sequence_for<Fields...>());
+	}
+
+	// Sorts the rows by column I, with operator< (numbers use 
+	// grinliz::Sort's radix sort) or a less(a, b) on the field.
+	template<int I>
+	void SortByColumn() {
+		using K = FieldType<I>;
+		if constexpr (std::is_arithmetic<K>::value)
+			SortByColumnImpl<I>([](const SortEntry<K>& e) { return e.key; });
+		else
+			SortByColumnImpl<I>([](const SortEntry<K>& a, const SortEntry<K>& b) { return a.key < b.key; });
+	}
+
+	template<int I, class Less>
+	void SortByColumn(Less less) {
+		using K = FieldType<I>;
+		SortByColumnImpl<I>([&less](const SortEntry<K>& a, const SortEntry<K>& b) { return less(a.key, b.key); });
+	}
+
+	// Puts the rows in the order of 'order': row i becomes 
+	// the old row order[i]. 'order' is a permutation of Size().
+	void Permute(const int* order) {
+		uint8_t* newMem = (uint8_t*)DefaultAlloc::Alloc(AllocSize(capacity), COLUMN_ALIGN);
+		void* newCols[NUM_FIELDS];
+		Layout(newMem, capacity, newCols);
+		PermuteImpl(newCols, order, std::index_sequence_for<Fields...>());
+		DefaultAlloc::Free(mem, AllocSize(capacity), COLUMN_ALIGN);
+		mem = newMem;
+		for (int i = 0; i < NUM_FIELDS; ++i)
+			cols[i] = newCols[i];
+	}
+
+	size_t MemoryInUse() const { return AllocSize(capacity); }
+
+private:
+	static constexpr size_t SIZES[NUM_FIELDS] = { sizeof(Fields)... };
+
+	template<class K>
+	struct SortEntry {
+		K key;
+		int index;
+	};
+
+	static size_t ColumnBytes(int c, int cap) {
+		return (SIZES[c] * size_t(cap) + COLUMN_ALIGN - 1) & ~(COLUMN_ALIGN - 1);
+	}
+	static size_t AllocSize(int cap) {
+		size_t total = 0;
+		for (int c = 0; c < NUM_FIELDS; ++c)
+			total += ColumnBytes(c, cap);
+		return total;
+	}
+	static void Layout(uint8_t* m, int cap, void** c) {
+		for (int i = 0; i < NUM_FIELDS; ++i) {
+			c[i] = m;
+			m += ColumnBytes(i, cap);
+		}
+	}
+
+	void Reallocate(int n) {
+		uint8_t* newMem = (uint8_t*)DefaultAlloc::Alloc(AllocSize(n), COLUMN_ALIGN);
+		void* newCols[NUM_FIELDS];
+		Layout(newMem, n, newCols);
+		for (int i = 0; i < NUM_FIELDS; ++i) {
+			if (size) memcpy(newCols[i], cols[i], size * SIZES[i]);
+			cols[i] = newCols[i];
+		}
+		DefaultAlloc::Free(mem, AllocSize(capacity), COLUMN_ALIGN);
+		mem = newMem;
+		capacity = n;
+	}
+
+	template<size_t... Is>
+	void SetRowImpl(int i, std::index_sequence<Is...>, const Fields&... fields) {
+		((((Fields*)cols[Is])[i] = fields), ...);
+	}
+
+	template<size_t... Is>
+	std::tuple<Fields...> RowTupleImpl(int i, std::index_sequence<Is...>) const {
+		return std::tuple<Fields...>(((const Fields*)cols[Is])[i]...);
+	}
+
+	template<size_t... Is>
+	void PermuteImpl(void** newCols, const int* order, std::index_sequence<Is...>) {
+		(Gather((Fields*)newCols[Is], (const Fields*)cols[Is], order), ...);
+	}
+
+	template<class T>
+	void Gather(T* dst, const T* src, const int* order) {
+		for (int i = 0; i < size; ++i)
+			dst[i] = src[order[i]];
+	}
+
+	template<int I, class Func>
+	void SortByColumnImpl(Func func) {
+		using K = FieldType<I>;
+		if (size < 2) return;
+		SortEntry<K>* entries = (SortEntry<K>*)DefaultAlloc::Alloc(size * sizeof(SortEntry<K>), alignof(SortEntry<K>));
+		const K* keys = (const K*)cols[I];
+		for (int i = 0; i < size; ++i)
+			entries[i] = { keys[i], i };
+		grinliz::Sort(entries, size, func);
+
+		// The order goes over the entries, which are done with.
+		int* order = (int*)entries;
+		for (int i = 0; i < size; ++i)
+			order[i] = entries[i].index;
+		Permute(order);
+		DefaultAlloc::Free(entries, size * sizeof(SortEntry<K>), alignof(SortEntry<K>));
+	}
+
+	uint8_t* mem = 0;
+	void* cols[NUM_FIELDS] = {};
+	int size = 0;
+	int capacity = 0;
+};
+
+}	// namespace grinliz
+
+#endif // GRINLIZ_SOA_INCLUDED
@@ -0,0 +1,221 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#include "glsort.h"
+#include "glrandom.h"
+#include "glperformance.h"
+
+#include <string>
+#include <vector>
+
+using namespace grinliz;
+
+namespace {
+	struct Item {
+		float key;
+		int payload;
+	};
+
+	enum class Dist { RANDOM, SORTED, REVERSED, FEW_UNIQUE, ORGAN_PIPE, COUNT };
+	const char* DIST_NAME[] = { "random", "sorted", "reversed", "few unique", "organ pipe" };
+
+	void Fill(uint32_t* mem, int n, Dist dist, Random& random) {
+		for (int i = 0; i < n; ++i) {
+			switch (dist) {
+			case Dist::RANDOM:		mem[i] = random.Rand();				break;
+			case Dist::SORTED:		mem[i] = uint32_t(i);				break;
+			case Dist::REVERSED:	mem[i] = uint32_t(n - i);			break;
+			case Dist::FEW_UNIQUE:	mem[i] = random.Rand(16);			break;
+			default:				mem[i] = uint32_t(i < n / 2 ? i : n - i);	break;
+			}
+		}
+	}
+
+	template<class T, class Less>
+	bool IsSorted(const T* mem, int n, Less less) {
+		for (int i = 1; i < n; ++i) {
+			if (less(mem[i], mem[i - 1]))
+				return false;
+		}
+		return true;
+	}
+
+	// The sort grinliz used before pdqsort. Kept as the baseline 
+	// for BenchSort().
+	inline int CombSortGap(int gap)
+	{
+		// shrink: 1.247
+		// 9 or 10 go to 11 (awesome)
+		//							   0  1  2  3  4  5  6  7  8  9 10 11  12  13  14  15
+		static const int table[16] = { 1, 1, 1, 2, 3, 4, 4, 5, 6, 7, 8, 8, 11, 11, 11, 12 };
+		if (gap < 16) {
+			gap = table[gap];
+		}
+		else {
+			gap = (gap * 103) >> 7;
+		}
+		return gap;
+	}
+
+	template <class T, typename LessFunc >
+	void CombSort(T* mem, int size, LessFunc lessfunc)
+	{
+		int gap = size;
+		for (;;) {
+			gap = CombSortGap(gap);
+			bool swapped = false;
+			const int end = size - gap;
+			for (int i = 0; i < end; i++) {
+				int j = i + gap;
+				if (lessfunc(mem[j], mem[i])) {
+					Swap(mem[i], mem[j]);
+					swapped = true;
+				}
+			}
+			if (gap == 1 && !swapped) {
+				break;
+			}
+		}
+	}
+}
+
+
+void grinliz::TestSort()
+{
+	Random random(5);
+	static const int SIZES[] = { 0, 1, 2, 3, 10, 23, 24, 25, 100, 255, 256, 1000, 100'000 };
+	std::vector<uint32_t> a, check;
+
+	for (int n : SIZES) {
+		a.resize(n);
+		for (int d = 0; d < int(Dist::COUNT); ++d) {
+			Fill(a.data(), n, Dist(d), random);
+			check = a;
+			std::sort(check.begin(), check.end());
+
+			// Radix (by value) and pdqsort (by less).
+			Sort(a.data(), n);
+			GLASSERT(a == check);
+			Fill(a.data(), n, Dist(d), random);
+			check = a;
+			std::sort(check.begin(), check.end());
+			Sort(a.data(), n, [](uint32_t x, uint32_t y) { return x < y; });
+			GLASSERT(a == check);
+		}
+	}
+	{
+		// Signed and floating point keys.
+		static const int N = 5000;
+		std::vector<int64_t> ints(N);
+		std::vector<double> doubles(N);
+		for (int i = 0; i < N; ++i) {
+			ints[i] = int64_t(random.Rand()) * (random.Bit() ? -1 : 1) * 1000;
+			doubles[i] = random.Uniform() * 2000.0 - 1000.0;
+		}
+		ints[0] = INT64_MIN;
+		ints[1] = INT64_MAX;
+		doubles[0] = -1e300;
+		Sort(ints.data(), N);
+		GLASSERT(IsSorted(ints.data(), N, [](int64_t x, int64_t y) { return x < y; }));
+		Sort(doubles.data(), N);
+		GLASSERT(IsSorted(doubles.data(), N, [](double x, double y) { return x < y; }));
+		GLASSERT(doubles[0] == -1e300);
+	}
+	{
+		// Structs, by less and by key.
+		static const int N = 3000;
+		std::vector<Item> items(N);
+		for (int i = 0; i < N; ++i)
+			items[i] = { float(random.Rand(200)) - 100.0f, i };
+		auto byKey = [](const Item& a, const Item& b) { return a.key < b.key; };
+
+		Sort(items.data(), N, byKey);
+		GLASSERT(IsSorted(items.data(), N, byKey));
+		random.ShuffleArray(items.data(), N);
+		Sort(items.data(), N, [](const Item& item) { return item.key; });
+		GLASSERT(IsSorted(items.data(), N, byKey));
+
+		// Nothing lost or duplicated.
+		int sum = 0;
+		for (const Item& item : items) sum += item.payload;
+		GLASSERT(sum == N * (N - 1) / 2);
+	}
+	{
+		// Not trivially copyable: always pdqsort.
+		std::vector<std::string> strs;
+		for (int i = 0; i < 500; ++i)
+			strs.push_back(std::to_string(random.Rand(1000)));
+		Sort(strs.data(), int(strs.size()));
+		GLASSERT(IsSorted(strs.data(), int(strs.size()), [](const std::string& x, const std::string& y) { return x < y; }));
+		Sort(strs.data(), int(strs.size()), [](const std::string& s) { return s.size(); });
+		GLASSERT(IsSorted(strs.data(), int(strs.size()), [](const std::string& x, const std::string& y) { return x.size() < y.size(); }));
+	}
+}
+
+
+void grinliz::BenchSort()
+{
+	static const int N = 1'000'000;
+	Random random(19);
+	std::vector<uint32_t> src(N), a(N);
+	std::vector<Item> srcItems(N), items(N);
+
+	auto time = [](auto func) {
+		timePoint_t start = Now();
+		func();
+		return DeltaSeconds(start, Now()) * 1000.0;
+	};
+	auto less = [](uint32_t x, uint32_t y) { return x < y; };
+	auto itemLess = [](const Item& x, const Item& y) { return x.key < y.key; };
+	auto itemKey = [](const Item& x) { return x.key; };
+
+	printf("Sort %d elements (ms)\n", N);
+	printf("  %-11s %10s %10s %10s %10s | %10s %10s %10s\n", "uint32_t:", "CombSort", "std::sort", "pdqsort", "radix",
+		"Item less", "Item key", "std::sort");
+	for (int d = 0; d < int(Dist::COUNT); ++d) {
+		Fill(src.data(), N, Dist(d), random);
+		for (int i = 0; i < N; ++i)
+			srcItems[i] = { float(src[i]) * 0.5f, i };
+
+		a = src;
+		double tComb = time([&]() { CombSort(a.data(), N, less); });
+		a = src;
+		double tStd = time([&]() { std::sort(a.begin(), a.end()); });
+		a = src;
+		double tPdq = time([&]() { Sort(a.data(), N, less); });
+		a = src;
+		double tRadix = time([&]() { Sort(a.data(), N); });
+
+		items = srcItems;
+		double tItemLess = time([&]() { Sort(items.data(), N, itemLess); });
+		items = srcItems;
+		double tItemKey = time([&]() { Sort(items.data(), N, itemKey); });
+		items = srcItems;
+		double tItemStd = time([&]() { std::sort(items.begin(), items.end(), itemLess); });
+
+		printf("  %-11s %10.1f %10.1f %10.1f %10.1f | %10.1f %10.1f %10.1f\n", DIST_NAME[d],
+			tComb, tStd, tPdq, tRadix, tItemLess, tItemKey, tItemStd);
+	}
+}
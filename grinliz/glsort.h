@@ -0,0 +1,397 @@
+/*
+Copyright (c) 2000-2019 Lee Thomason (www.grinninglizard.com)
+Grinning Lizard Utilities.
+
+This software is provided 'as-is', without any express or implied 
+warranty. In no event will the authors be held liable for any 
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any 
+purpose, including commercial applications, and to alter it and 
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must 
+not claim that you wrote the original software. If you use this 
+software in a product, an acknowledgment in the product documentation 
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and 
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source 
+distribution.
+*/
+
+
+#ifndef GRINLIZ_SORT_INCLUDED
+#define GRINLIZ_SORT_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "gldebug.h"
+#include "glutil.h"
+#include "glmemory.h"
+
+namespace grinliz
+{
+
+void TestSort();
+void BenchSort();
+
+/*
+	::Sort(T* mem, int size);					uses operator <
+	::Sort(T* mem, int size, LessFunc func);	less(a, b) lambda
+	::Sort(T* mem, int size, KeyFunc func);		key(a) lambda, returning a number
+
+	Comparison sorts are a pattern-defeating quicksort (pdqsort): 
+	quicksort with a median-of-3 (or ninther) pivot, insertion sort
+	for small partitions, detection of already sorted runs, and a 
+	heapsort fallback that bounds the worst case at O(n log n).
+
+	Arrays of numbers, and sorts by a key function, use an LSD radix
+	sort instead: one pass per byte of the key, skipping bytes that 
+	are the same for every key. That needs T to be trivially copyable
+	and a temporary copy of the array. Small arrays always use pdqsort.
+
+	Neither is stable.
+*/
+namespace sortimpl
+{
+	static constexpr int INSERTION_SORT_THRESHOLD = 24;
+	static constexpr int NINTHER_THRESHOLD = 128;
+	static constexpr int PARTIAL_INSERTION_SORT_LIMIT = 8;
+	static constexpr int RADIX_THRESHOLD = 256;
+
+	template<class T>
+	inline void IterSwap(T* a, T* b) { Swap(*a, *b); }
+
+	template<class T, class Less>
+	void InsertionSort(T* begin, T* end, Less& less) {
+		if (begin == end) return;
+		for (T* cur = begin + 1; cur != end; ++cur) {
+			T* sift = cur;
+			T* sift1 = cur - 1;
+			if (less(*sift, *sift1)) {
+				T tmp(std::move(*sift));
+				do {
+					*sift-- = std::move(*sift1);
+				} while (sift != begin && less(tmp, *--sift1));
+				*sift = std::move(tmp);
+			}
+		}
+	}
+
+	// Insertion sort where *(begin - 1) is known to be no greater
+	// than anything in [begin, end), so there's no bounds check.
+	template<class T, class Less>
+	void UnguardedInsertionSort(T* begin, T* end, Less& less) {
+		if (begin == end) return;
+		for (T* cur = begin + 1; cur != end; ++cur) {
+			T* sift = cur;
+			T* sift1 = cur - 1;
+			if (less(*sift, *sift1)) {
+				T tmp(std::move(*sift));
+				do {
+					*sift-- = std::move(*sift1);
+				} while (less(tmp, *--sift1));
+				*sift = std::move(tmp);
+			}
+		}
+	}
+
+	// Insertion sort that gives up (returning false) once it has
+	// moved more than PARTIAL_INSERTION_SORT_LIMIT elements.
+	template<class T, class Less>
+	bool PartialInsertionSort(T* begin, T* end, Less& less) {
+		if (begin == end) return true;
+		int limit = 0;
+		for (T* cur = begin + 1; cur != end; ++cur) {
+			T* sift = cur;
+			T* sift1 = cur - 1;
+			if (less(*sift, *sift1)) {
+				T tmp(std::move(*sift));
+				do {
+					*sift-- = std::move(*sift1);
+				} while (sift != begin && less(tmp, *--sift1));
+				*sift = std::move(tmp);
+				limit += int(cur - sift);
+			}
+			if (limit > PARTIAL_INSERTION_SORT_LIMIT) return false;
+		}
+		return true;
+	}
+
+	template<class T, class Less>
+	inline void Sort2(T* a, T* b, Less& less) {
+		if (less(*b, *a)) IterSwap(a, b);
+	}
+
+	template<class T, class Less>
+	inline void Sort3(T* a, T* b, T* c, Less& less) {
+		Sort2(a, b, less);
+		Sort2(b, c, less);
+		Sort2(a, b, less);
+	}
+
+	// Partitions around the pivot *begin. Elements equal to the pivot
+	// go to the right. Returns the pivot's final position, and sets
+	// 'alreadyPartitioned' if no elements were swapped.
+	template<class T, class Less>
+	T* PartitionRight(T* begin, T* end, Less& less, bool* alreadyPartitioned) {
+		T pivot(std::move(*begin));
+		T* first = begin;
+		T* last = end;
+
+		// The median of 3 guarantees these loops stop.
+		while (less(*++first, pivot)) {}
+		if (first - 1 == begin) {
+			while (first < last && !less(*--last, pivot)) {}
+		}
+		else {
+			while (!less(*--last, pivot)) {}
+		}
+
+		*alreadyPartitioned = first >= last;
+		while (first < last) {
+			IterSwap(first, last);
+			while (less(*++first, pivot)) {}
+			while (!less(*--last, pivot)) {}
+		}
+
+		T* pivotPos = first - 1;
+		*begin = std::move(*pivotPos);
+		*pivotPos = std::move(pivot);
+		return pivotPos;
+	}
+
+	// Like PartitionRight, but equal elements go to the left. Used 
+	// when the pivot equals the element before the partition: then
+	// everything equal to it is done, and only the right is sorted.
+	template<class T, class Less>
+	T* PartitionLeft(T* begin, T* end, Less& less) {
+		T pivot(std::move(*begin));
+		T* first = begin;
+		T* last = end;
+
+		while (less(pivot, *--last)) {}
+		if (last + 1 == end) {
+			while (first < last && !less(pivot, *++first)) {}
+		}
+		else {
+			while (!less(pivot, *++first)) {}
+		}
+
+		while (first < last) {
+			IterSwap(first, last);
+			while (less(pivot, *--last)) {}
+			while (!less(pivot, *++first)) {}
+		}
+
+		T* pivotPos = last;
+		*begin = std::move(*pivotPos);
+		*pivotPos = std::move(pivot);
+		return pivotPos;
+	}
+
+	template<class T, class Less>
+	void PDQSortLoop(T* begin, T* end, Less& less, int badAllowed, bool leftmost) {
+		while (true) {
+			const int size = int(end - begin);
+			if (size < INSERTION_SORT_THRESHOLD) {
+				if (leftmost) InsertionSort(begin, end, less);
+				else UnguardedInsertionSort(begin, end, less);
+				return;
+			}
+
+			// Pivot: median of 3, or the pseudo median of 9 for big 
+			// partitions. It's moved to *begin.
+			const int s2 = size / 2;
+			if (size > NINTHER_THRESHOLD) {
+				Sort3(begin, begin + s2, end - 1, less);
+				Sort3(begin + 1, begin + (s2 - 1), end - 2, less);
+				Sort3(begin + 2, begin + (s2 + 1), end - 3, less);
+				Sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), less);
+				IterSwap(begin, begin + s2);
+			}
+			else {
+				Sort3(begin + s2, begin, end - 1, less);
+			}
+
+			// The pivot equals the element before this partition, so 
+			// nothing here is less than it. Put the equal elements on
+			// the left and move on; this makes many duplicates O(n).
+			if (!leftmost && !less(*(begin - 1), *begin)) {
+				begin = PartitionLeft(begin, end, less) + 1;
+				continue;
+			}
+
+			bool alreadyPartitioned = false;
+			T* pivotPos = PartitionRight(begin, end, less, &alreadyPartitioned);
+
+			const int lSize = int(pivotPos - begin);
+			const int rSize = int(end - (pivotPos + 1));
+			if (lSize < size / 8 || rSize < size / 8) {
+				// A bad partition. Too many, and this input is
+				// defeating quicksort: switch to heapsort.
+				if (--badAllowed == 0) {
+					std::make_heap(begin, end, less);
+					std::sort_heap(begin, end, less);
+					return;
+				}
+				// Otherwise break up patterns by shuffling a few elements.
+				if (lSize >= INSERTION_SORT_THRESHOLD) {
+					IterSwap(begin, begin + lSize / 4);
+					IterSwap(pivotPos - 1, pivotPos - lSize / 4);
+					if (lSize > NINTHER_THRESHOLD) {
+						IterSwap(begin + 1, begin + (lSize / 4 + 1));
+						IterSwap(begin + 2, begin + (lSize / 4 + 2));
+						IterSwap(pivotPos - 2, pivotPos - (lSize / 4 + 1));
+						IterSwap(pivotPos - 3, pivotPos - (lSize / 4 + 2));
+					}
+				}
+				if (rSize >= INSERTION_SORT_THRESHOLD) {
+					IterSwap(pivotPos + 1, pivotPos + (1 + rSize / 4));
+					IterSwap(end - 1, end - rSize / 4);
+					if (rSize > NINTHER_THRESHOLD) {
+						IterSwap(pivotPos + 2, pivotPos + (2 + rSize / 4));
+						IterSwap(pivotPos + 3, pivotPos + (3 + rSize / 4));
+						IterSwap(end - 2, end - (1 + rSize / 4));
+						IterSwap(end - 3, end - (2 + rSize / 4));
+					}
+				}
+			}
+			else if (alreadyPartitioned
+				&& PartialInsertionSort(begin, pivotPos, less)
+				&& PartialInsertionSort(pivotPos + 1, end, less))
+			{
+				// Already (nearly) sorted input.
+				return;
+			}
+
+			// Recurse on the left, loop on the right.
+			PDQSortLoop(begin, pivotPos, less, badAllowed, leftmost);
+			begin = pivotPos + 1;
+			leftmost = false;
+		}
+	}
+
+	template<class T, class Less>
+	void PDQSort(T* mem, int size, Less& less) {
+		if (size < 2) return;
+		PDQSortLoop(mem, mem + size, less, int(LogBase2(uint32_t(size))) + 1, true);
+	}
+
+	// Maps a number to an unsigned integer with the same order.
+	template<class K>
+	inline auto RadixBits(K k) {
+		static_assert(std::is_arithmetic<K>::value, "radix keys must be numbers");
+		if constexpr (std::is_floating_point<K>::value) {
+			static_assert(sizeof(K) == 4 || sizeof(K) == 8, "float or double");
+			using U = typename std::conditional<sizeof(K) == 4, uint32_t, uint64_t>::type;
+			constexpr int BITS = sizeof(K) * 8;
+			U u;
+			memcpy(&u, &k, sizeof(K));
+			// Negative: flip everything. Positive: flip the sign.
+			U mask = U(0) - (u >> (BITS - 1));
+			return U(u ^ (mask | (U(1) << (BITS - 1))));
+		}
+		else if constexpr (std::is_same<K, bool>::value) {
+			return uint8_t(k);
+		}
+		else if constexpr (std::is_signed<K>::value) {
+			using U = typename std::make_unsigned<K>::type;
+			return U(U(k) ^ (U(1) << (sizeof(K) * 8 - 1)));
+		}
+		else {
+			return k;
+		}
+	}
+
+	template<class T, class KeyFunc>
+	void RadixSort(T* mem, int size, KeyFunc& key) {
+		using K = typename std::decay<decltype(key(*mem))>::type;
+		using U = decltype(RadixBits(K()));
+		static constexpr int PASSES = sizeof(U);
+
+		// All the histograms in one read pass.
+		uint32_t hist[PASSES][256];
+		memset(hist, 0, sizeof(hist));
+		for (int i = 0; i < size; ++i) {
+			U b = RadixBits(key(mem[i]));
+			for (int p = 0; p < PASSES; ++p)
+				hist[p][(b >> (p * 8)) & 0xff]++;
+		}
+
+		T* tmp = (T*)DefaultAlloc::Alloc(sizeof(T) * size, alignof(T));
+		T* src = mem;
+		T* dst = tmp;
+		for (int p = 0; p < PASSES; ++p) {
+			const uint32_t* h = hist[p];
+			// Every key has the same byte: nothing to do.
+			if (h[(RadixBits(key(src[0])) >> (p * 8)) & 0xff] == uint32_t(size))
+				continue;
+
+			uint32_t offset[256];
+			uint32_t sum = 0;
+			for (int d = 0; d < 256; ++d) {
+				offset[d] = sum;
+				sum += h[d];
+			}
+			for (int i = 0; i < size; ++i) {
+				U b = RadixBits(key(src[i]));
+				memcpy((void*)(dst + offset[(b >> (p * 8)) & 0xff]++), (const void*)(src + i), sizeof(T));
+			}
+			Swap(src, dst);
+		}
+		if (src != mem)
+			memcpy((void*)mem, (const void*)src, sizeof(T) * size);
+		DefaultAlloc::Free(tmp, sizeof(T) * size, alignof(T));
+	}
+
+	template<class T, class KeyFunc>
+	void SortByKey(T* mem, int size, KeyFunc& key) {
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			if (size >= RADIX_THRESHOLD) {
+				RadixSort(mem, size, key);
+				return;
+			}
+		}
+		// Compare in radix order, so both paths agree.
+		auto less = [&key](const T& a, const T& b) {
+			return RadixBits(key(a)) < RadixBits(key(b));
+		};
+		PDQSort(mem, size, less);
+	}
+}
+
+template <class T, typename Func>
+inline void Sort(T* mem, int size, Func func)
+{
+	if constexpr (std::is_invocable<Func&, const T&, const T&>::value) {
+		sortimpl::PDQSort(mem, size, func);
+	}
+	else {
+		static_assert(std::is_invocable<Func&, const T&>::value, "Sort needs a less(a, b) or key(a) function");
+		sortimpl::SortByKey(mem, size, func);
+	}
+}
+
+template <typename T>
+inline void Sort(T* mem, int size) {
+	if constexpr (std::is_arithmetic<T>::value) {
+		auto key = [](T t) { return t; };
+		sortimpl::SortByKey(mem, size, key);
+	}
+	else {
+		auto less = [](const T& a, const T& b) { return a < b; };
+		sortimpl::PDQSort(mem, size, less);
+	}
+}
+
+} // namespace grinliz
+
+#endif // GRINLIZ_SORT_INCLUDED
@@ -30,7 +30,7 @@ void StringPool::Destroy()
 {
 	printf("StringPool: blocks=%d totalMem=%dk nStrings=%d\n", blocks.Size(), TotalMem() / 1024, NumStrings());
 	for (int i = 0; i < blocks.Size(); ++i) {
-		free(blocks[i].mem);
+		DefaultAlloc::Free(blocks[i].mem, STRINGPOOL_MAX_SIZE, MALLOC_ALIGN);
 	}
 	blocks.FreeMem();
 	stringHash.Free();
@@ -91,7 +91,7 @@ const char* StringPool::InternInner(const char* str, uint64_t* hashOut)
 	}
 	if (blockIndex < 0) {
 		Block b;
-		b.mem = (uint8_t*)malloc(STRINGPOOL_MAX_SIZE);
+		b.mem = (uint8_t*)DefaultAlloc::Alloc(STRINGPOOL_MAX_SIZE, MALLOC_ALIGN);
 		blockIndex = blocks.Size();
 		blocks.Push(b);
 	}
@@ -155,6 +155,14 @@ bool StringPool::Test()
 		GLASSERT(c == foo);
 		GLASSERT(c == "Foo");
 		GLASSERT(d == bar);
+
+		HashTable<IString, int, IStringHash> table;
+		table.Add(a, 1);
+		table.Add(b, 2);
+		table.Add(foo, 3);
+		GLASSERT(table.Get(StringPool::Intern("Hello")) == 1);
+		GLASSERT(table.Get(c) == 3);
+		GLASSERT(!table.TryGet(bar, 0));
 		StringPool::Destroy();
 	}
 	return true;
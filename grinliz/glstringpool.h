@@ -53,6 +53,15 @@ private:
 };
 
 
+// Interned strings are equal if their pointers are, so
+// that's all a hash table needs to look at.
+struct IStringHash
+{
+	static uint64_t Hash(const IString& s) { return uint64_t(s.IntPtr()); }
+	static bool Equal(const IString& a, const IString& b) { return a == b; }
+};
+
+
 class StringPool
 {
 public:
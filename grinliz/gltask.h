@@ -1,6 +1,7 @@
 #pragma once
 
 #include "enkiTS/TaskScheduler.h"
+#include "glpool.h"
 
 namespace grinliz {
 
@@ -39,6 +40,12 @@ namespace grinliz {
         virtual ~SelfDeletingTask() {
             //printf("SelfDeletingTask deleted\n");
         }
+
+        // Lots of small tasks are created and deleted, on any thread,
+        // so they come from the small block allocators. The virtual 
+        // destructor means 'size' is the size of the subclass.
+        static void* operator new(size_t size) { return SmallAlloc(size); }
+        static void operator delete(void* p, size_t size) { SmallFree(p, size); }
     };
 
     class JobHandle {
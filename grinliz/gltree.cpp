@@ -111,6 +111,12 @@ bool grinliz::TreeTest()
 			tree.Query({ {2, 0}, {1, 1} }, out);
 			GLASSERT(out.size() == 1);
 			GLASSERT(out[0].value == 2);
+
+			Arena arena;
+			CDynArray<Tree<Rect2F, int>::Data> scratch;
+			scratch.SetArena(&arena);
+			tree.Query({ {0, 0}, {3, 1} }, scratch);
+			GLASSERT(scratch.Size() == 102);
 		}
 	}
 	{
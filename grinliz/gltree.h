@@ -49,7 +49,14 @@ namespace grinliz {
 		// at the same time.
 		void Query(const R& rect, std::vector<Tree::Data>& r) const {
 			r.clear();
-			QueryRec(rect, r, m_nodes);
+			QueryRec(rect, [&r](const Data& d) { r.push_back(d); }, m_nodes);
+		}
+
+		// The same, for a CDynArray, which can be set to use
+		// an Arena for per frame queries.
+		void Query(const R& rect, CDynArray<Tree::Data>& r) const {
+			r.Clear();
+			QueryRec(rect, [&r](const Data& d) { r.Push(d); }, m_nodes);
 		}
 
 		void Clear() {
@@ -162,21 +169,22 @@ namespace grinliz {
 			SplitNode(right);
 		}
 
-		void QueryRec(const R& rect, std::vector<Tree::Data>& r, const Node* node) const {
+		template<typename Func>
+		void QueryRec(const R& rect, Func&& add, const Node* node) const {
 			const Node* left = Child(node, LEFT);
 			const Node* right = Child(node, RIGHT);
 
 			// Note the use of IntersectsIncl so that we don't miss
 			// a right edge node.
 			if (left && left->bounds.IntersectsIncl(rect))
-				QueryRec(rect, r, left);
+				QueryRec(rect, add, left);
 			if (right && right->bounds.IntersectsIncl(rect))
-				QueryRec(rect, r, right);
+				QueryRec(rect, add, right);
 
 			if (node->Leaf()) {
 				for (int i = 0; i < node->count; ++i) {
 					if (rect.Contains(m_data[i + node->start].pos)) {
-						r.push_back(m_data[i + node->start]);
+						add(m_data[i + node->start]);
 					}
 				}
 			}
@@ -26,6 +26,10 @@ distribution.
 #define GRINLIZ_UTIL_INCLUDED
 
 #include <stdint.h>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace grinliz {
 
@@ -43,7 +47,7 @@ namespace grinliz {
 	template <class T> inline T		Max(T a, T b, T c, T d) { return Max(d, Max(a, b, c)); }
 
 	/// Swap
-	template <class T> inline void	Swap(T& a, T& b) { T temp; temp = a; a = b; b = temp; }
+	template <class T> inline void	Swap(T& a, T& b) { T temp(std::move(a)); a = std::move(b); b = std::move(temp); }
 	/// Returns true if value in the range [lower, upper]
 	template <class T> inline bool	InRange(const T& a, const T& lower, const T& upper) { return a >= lower && a <= upper; }
 	/// Returned the value clamped to the range [lower, upper]
@@ -70,6 +74,17 @@ namespace grinliz {
 		return b + 0x9e3779b9 + (a << 6) + (a >> 2);
 	}
 
+	// The MurmurHash3 finalizer. Every input bit affects every
+	// output bit, which makes it a good hash for integer keys.
+	inline uint64_t HashMix64(uint64_t k) {
+		k ^= k >> 33;
+		k *= 0xff51afd7ed558ccdULL;
+		k ^= k >> 33;
+		k *= 0xc4ceb9fe1a85ec53ULL;
+		k ^= k >> 33;
+		return k;
+	}
+
 	template<typename T>
 	bool EqualFromLessThan(const T& a, const T& b) {
 		if (a < b) return false;
@@ -96,6 +111,63 @@ namespace grinliz {
 		return r;
 	}
 
+	/// Index of the lowest bit set. 'v' may not be 0.
+	inline int CountTrailingZeros(uint32_t v)
+	{
+#if defined(_MSC_VER)
+		unsigned long r = 0;
+		_BitScanForward(&r, v);
+		return int(r);
+#else
+		return __builtin_ctz(v);
+#endif
+	}
+
+	/// Index of the lowest bit set. 'v' may not be 0.
+	inline int CountTrailingZeros64(uint64_t v)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long r = 0;
+		_BitScanForward64(&r, v);
+		return int(r);
+#elif defined(_MSC_VER)
+		return uint32_t(v) ? CountTrailingZeros(uint32_t(v)) : 32 + CountTrailingZeros(uint32_t(v >> 32));
+#else
+		return __builtin_ctzll(v);
+#endif
+	}
+
+	/// Number of bits set.
+	inline int PopCount64(uint64_t v)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		return int(__popcnt64(v));
+#elif defined(__GNUC__)
+		return __builtin_popcountll(v);
+#else
+		v = v - ((v >> 1) & 0x5555555555555555ULL);
+		v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+		v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+		return int((v * 0x0101010101010101ULL) >> 56);
+#endif
+	}
+
+	/// Hint that the cache line at 'p' will be read soon. 
+	inline void Prefetch(const void* p)
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch((const char*)p, _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(p);
+		// gcc considers a prefetch free of side effects, and will
+		// discard calls to a function that only prefetches. The
+		// empty asm is a side effect that keeps it.
+		asm volatile("" : : "r"(p));
+#else
+		(void)p;
+#endif
+	}
+
 	/// Round down to the next power of 2
 	inline uint32_t FloorPowerOf2(uint32_t v)
 	{